@@ -24,6 +24,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #define M64P_CORE_PROTOTYPES 1
 #include "callbacks.h"
@@ -460,3 +461,34 @@ EXPORT uint32_t CALL DebugVirtualToPhysical(uint32_t address)
     return address;
 #endif
 }
+
+EXPORT m64p_error CALL DebugGetStats(m64p_dbg_stats_type stats_type, void *stats, int size)
+{
+    if (stats == NULL || size < 0)
+        return M64ERR_INPUT_ASSERT;
+
+    switch (stats_type)
+    {
+        case M64P_DBG_STATS_DYNAREC:
+        {
+#ifdef NEW_DYNAREC
+            m64p_dbg_dynarec_stats dynarec_stats;
+            new_dynarec_get_stats(&dynarec_stats);
+            memcpy(stats, &dynarec_stats, ((size_t)size < sizeof(dynarec_stats)) ? (size_t)size : sizeof(dynarec_stats));
+            return M64ERR_SUCCESS;
+#else
+            return M64ERR_UNSUPPORTED;
+#endif
+        }
+        case M64P_DBG_STATS_FRAME_PACER:
+        {
+            m64p_dbg_frame_pacer_stats pacer_stats;
+            main_get_frame_pacer_stats(&pacer_stats);
+            memcpy(stats, &pacer_stats, ((size_t)size < sizeof(pacer_stats)) ? (size_t)size : sizeof(pacer_stats));
+            return M64ERR_SUCCESS;
+        }
+        default:
+            DebugMessage(M64MSG_WARNING, "Bug: invalid m64p_dbg_stats_type input in DebugGetStats()");
+            return M64ERR_INPUT_INVALID;
+    }
+}
@@ -214,6 +214,17 @@ typedef uint32_t (*ptr_DebugVirtualToPhysical)(uint32_t);
 EXPORT uint32_t CALL DebugVirtualToPhysical(uint32_t);
 #endif
 
+/* DebugGetStats()
+ *
+ * This function is used to read performance counters of the emulator core,
+ * such as the activity of the dynamic recompiler. It is available even if the
+ * core was built without debugger support.
+ */
+typedef m64p_error (*ptr_DebugGetStats)(m64p_dbg_stats_type, void *, int);
+#if defined(M64P_CORE_PROTOTYPES)
+EXPORT m64p_error CALL DebugGetStats(m64p_dbg_stats_type, void *, int);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -401,6 +401,47 @@ typedef struct {
   unsigned int flags;
 } m64p_breakpoint;
 
+typedef enum {
+  M64P_DBG_STATS_DYNAREC = 1,
+  M64P_DBG_STATS_FRAME_PACER
+} m64p_dbg_stats_type;
+
+/* New fields are only ever appended, see DebugGetStats() */
+typedef struct {
+  uint64_t blocks_compiled;
+  uint64_t bytes_emitted;           /* host code generated */
+  uint64_t compile_time_ns;
+  uint64_t invalidations_write;     /* pages invalidated by stores from recompiled code */
+  uint64_t invalidations_external;  /* pages invalidated by DMA and other writes from outside the CPU */
+  uint64_t invalidations_tlb;       /* pages invalidated by TLB updates */
+  uint64_t invalidations_all;       /* whole cache flushes */
+  uint64_t blocks_invalidated;      /* entry points discarded by invalidations */
+  uint64_t cache_wraps;             /* code output restarted from the beginning of the cache */
+  uint64_t cache_grows;
+  uint64_t expiry_steps;
+  uint64_t blocks_expired;          /* entry points discarded to make room in the cache */
+  uint64_t links;                   /* direct branches patched between blocks */
+  uint64_t unlinks;                 /* direct branches reverted to the linker stub */
+  uint64_t dynamic_linker_calls;    /* branches resolved through dynamic_linker */
+  uint64_t verify_dirty_hits;       /* dirty blocks found unchanged and reused */
+  uint64_t verify_dirty_misses;
+  uint64_t cache_size;              /* bytes of code cache currently in use */
+  uint64_t invalidations_skipped;   /* external writes to code pages which missed every compiled block */
+  uint64_t jump_ic_hits;            /* JR/JALR targets found in the inline cache of the jump (DBG builds only) */
+  uint64_t jump_ic_misses;          /* JR/JALR targets looked up in the hash table (DBG builds only) */
+} m64p_dbg_dynarec_stats;
+
+/* New fields are only ever appended, see DebugGetStats() */
+typedef struct {
+  uint64_t frames;                  /* frame times measured since the ROM was started */
+  uint64_t total_ns;
+  uint64_t min_ns;
+  uint64_t max_ns;
+  uint64_t late;                    /* frames which started after their deadline */
+  uint64_t resyncs;                 /* schedule restarts after falling too far behind */
+  uint64_t spin_ns;                 /* time spent spinning instead of sleeping before each deadline */
+} m64p_dbg_frame_pacer_stats;
+
 /* ------------------------------------------------- */
 /* Structures and Types for Core Video Extension API */
 /* ------------------------------------------------- */
@@ -0,0 +1,55 @@
+#define offsetof_struct_cached_interp_invalid_code (0x00000000)
+#define offsetof_struct_cp0_count_per_op (0x0000057c)
+#define offsetof_struct_cp0_last_addr (0x00000578)
+#define offsetof_struct_cp0_next_interrupt (0x00000470)
+#define offsetof_struct_cp0_regs (0x00000000)
+#define offsetof_struct_cp0_tlb (0x00000584)
+#define offsetof_struct_device_r4300 (0x00000000)
+#define offsetof_struct_r4300_core_cached_interp (0x00004208)
+#define offsetof_struct_r4300_core_cp0 (0x00904538)
+#define offsetof_struct_r4300_core_hi (0x00000100)
+#define offsetof_struct_r4300_core_lo (0x00000108)
+#define offsetof_struct_r4300_core_recomp (0x00904288)
+#define offsetof_struct_r4300_core_regs (0x00000000)
+#define offsetof_struct_r4300_core_stop (0x00000128)
+#define offsetof_struct_recomp_return_address (0x00000178)
+#define offsetof_struct_recomp_save_rip (0x00000170)
+#define offsetof_struct_recomp_save_rsp (0x00000168)
+#define offsetof_struct_tlb_LUT_r (0x00000680)
+#define offsetof_struct_tlb_LUT_w (0x00400680)
+#define offsetof_struct_tlb_entries (0x00000000)
+#define offsetof_struct_cached_interp_invalid_code (0x00000000)
+#define offsetof_struct_cp0_count_per_op (0x000004fc)
+#define offsetof_struct_cp0_last_addr (0x000004f8)
+#define offsetof_struct_cp0_tlb (0x00000504)
+#define offsetof_struct_device_r4300 (0x00000000)
+#define offsetof_struct_new_dynarec_hot_state_branch_target (0x000004f0)
+#define offsetof_struct_new_dynarec_hot_state_cp0_regs (0x00000250)
+#define offsetof_struct_new_dynarec_hot_state_cp1_fcr0 (0x00000134)
+#define offsetof_struct_new_dynarec_hot_state_cp1_fcr31 (0x00000138)
+#define offsetof_struct_new_dynarec_hot_state_cp1_regs_double (0x000003d8)
+#define offsetof_struct_new_dynarec_hot_state_cp1_regs_simple (0x000002d8)
+#define offsetof_struct_new_dynarec_hot_state_cycle_count (0x00000100)
+#define offsetof_struct_new_dynarec_hot_state_dynarec_local (0x00000000)
+#define offsetof_struct_new_dynarec_hot_state_fake_pc (0x00000500)
+#define offsetof_struct_new_dynarec_hot_state_hi (0x00000240)
+#define offsetof_struct_new_dynarec_hot_state_invc_ptr (0x00000110)
+#define offsetof_struct_new_dynarec_hot_state_lo (0x00000248)
+#define offsetof_struct_new_dynarec_hot_state_memory_map (0x000007f0)
+#define offsetof_struct_new_dynarec_hot_state_mini_ht (0x000005f0)
+#define offsetof_struct_new_dynarec_hot_state_pc (0x000004f8)
+#define offsetof_struct_new_dynarec_hot_state_pcaddr (0x00000108)
+#define offsetof_struct_new_dynarec_hot_state_pending_exception (0x00000104)
+#define offsetof_struct_new_dynarec_hot_state_rd (0x000005e0)
+#define offsetof_struct_new_dynarec_hot_state_regs (0x00000140)
+#define offsetof_struct_new_dynarec_hot_state_rounding_modes (0x000004e0)
+#define offsetof_struct_new_dynarec_hot_state_rs (0x000005d0)
+#define offsetof_struct_new_dynarec_hot_state_rt (0x000005d8)
+#define offsetof_struct_new_dynarec_hot_state_stop (0x0000010c)
+#define offsetof_struct_r4300_core_cached_interp (0x000040f8)
+#define offsetof_struct_r4300_core_cp0 (0x00906988)
+#define offsetof_struct_r4300_core_extra_memory (0x00106178)
+#define offsetof_struct_r4300_core_new_dynarec_hot_state (0x00106180)
+#define offsetof_struct_tlb_LUT_r (0x00000680)
+#define offsetof_struct_tlb_LUT_w (0x00400680)
+#define offsetof_struct_tlb_entries (0x00000000)
@@ -31,6 +31,11 @@ struct audio_out_backend_interface
     void (*set_frequency)(void* aout, unsigned int frequency);
 
     /* Push samples to be played by the backend
+     *
+     * samples points directly into RDRAM, no copy is made by the core.
+     * It holds size bytes of 16-bit stereo samples stored as host 32-bit
+     * words (left channel in the upper half), and is only valid during
+     * the call: backends processing them later must copy them first.
      */
     void (*push_samples)(void* aout, const void* samples, size_t size);
 };
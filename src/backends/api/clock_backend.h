@@ -22,6 +22,7 @@
 #ifndef M64P_BACKENDS_API_CLOCK_BACKEND_H
 #define M64P_BACKENDS_API_CLOCK_BACKEND_H
 
+#include <stdint.h>
 #include <time.h>
 
 struct clock_backend_interface
@@ -29,6 +30,11 @@ struct clock_backend_interface
     /* Returns the current time
      */
     time_t (*get_time)(void* clock);
+
+    /* Returns a monotonic time in nanoseconds, only meaningful
+     * to measure durations
+     */
+    uint64_t (*get_time_ns)(void* clock);
 };
 
 #endif
@@ -23,6 +23,10 @@
 
 #include <time.h>
 
+#if defined(WIN32) && !defined(__MINGW32__)
+#include <windows.h>
+#endif
+
 
 time_t ctime_plus_delta_get_time(void* clock)
 {
@@ -33,7 +37,26 @@ time_t ctime_plus_delta_get_time(void* clock)
     return user_delta + time(NULL);
 }
 
+/* the user delta only applies to the calendar time */
+uint64_t ctime_plus_delta_get_time_ns(void* clock)
+{
+#if defined(WIN32) && !defined(__MINGW32__)
+    static LARGE_INTEGER freq = { 0 };
+    LARGE_INTEGER counter;
+    if (freq.QuadPart == 0)
+        QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)(counter.QuadPart / freq.QuadPart) * 1000000000
+         + (uint64_t)(counter.QuadPart % freq.QuadPart) * 1000000000 / freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+#endif
+}
+
 const struct clock_backend_interface g_iclock_ctime_plus_delta =
 {
-    ctime_plus_delta_get_time
+    ctime_plus_delta_get_time,
+    ctime_plus_delta_get_time_ns
 };
@@ -48,7 +48,8 @@ static void audio_plugin_push_samples(void* aout, const void* buffer, size_t siz
     uint32_t saved_ai_length = ai->regs[AI_LEN_REG];
     uint32_t saved_ai_dram = ai->regs[AI_DRAM_ADDR_REG];
 
-    /* exploit the fact that buffer points in g_dev.rdram.dram to retreive dram_addr_reg value */
+    /* exploit the fact that buffer points in g_dev.rdram.dram to retrieve dram_addr_reg value.
+     * The plugin reads the samples from RDRAM and converts them itself, during this call */
     ai->regs[AI_DRAM_ADDR_REG] = (uint32_t)((uint8_t*)buffer - (uint8_t*)ai->ri->rdram->dram);
     ai->regs[AI_LEN_REG] = (uint32_t)size;
 
@@ -32,6 +32,7 @@
 
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
+#include <string.h>
 
 #define CART_ROM_ADDR_MASK UINT32_C(0xefffffff);
 
@@ -96,37 +97,81 @@ unsigned int cart_rom_dma_read(void* opaque, const uint8_t* dram, uint32_t dram_
     return /* length / 8 */0x1000;
 }
 
+/* Copy length bytes between two byte swizzled memories. Whole words are
+ * copied at once when the destination is word aligned: as is when both
+ * addresses share the same byte lane, or by merging the halves of two
+ * source words when the lanes are 2 bytes apart (PI DMA addresses are even). */
+static void copy_swizzled(uint8_t* dst, uint32_t dst_addr, const uint8_t* src, uint32_t src_addr, size_t length)
+{
+    size_t i = 0;
+
+    for (; i < length && ((dst_addr + i) & 3) != 0; ++i) {
+        dst[(dst_addr+i)^S8] = src[(src_addr+i)^S8];
+    }
+
+    if (((dst_addr ^ src_addr) & 3) == 0) {
+        size_t n = (length - i) & ~(size_t)3;
+        memcpy(dst + dst_addr + i, src + src_addr + i, n);
+        i += n;
+    }
+    else if (((dst_addr ^ src_addr) & 3) == 2) {
+        uint32_t* dst32 = (uint32_t*)(dst + dst_addr + i);
+        const uint32_t* src32 = (const uint32_t*)(src + ((src_addr + i) & ~UINT32_C(3)));
+
+        for (; i + 4 <= length; i += 4, ++src32) {
+            *dst32++ = (src32[0] << 16) | (src32[1] >> 16);
+        }
+    }
+
+    for (; i < length; ++i) {
+        dst[(dst_addr+i)^S8] = src[(src_addr+i)^S8];
+    }
+}
+
+static void clear_swizzled(uint8_t* dst, uint32_t dst_addr, size_t length)
+{
+    size_t i = 0;
+
+    for (; i < length && ((dst_addr + i) & 3) != 0; ++i) {
+        dst[(dst_addr+i)^S8] = 0;
+    }
+
+    memset(dst + dst_addr + i, 0, (length - i) & ~(size_t)3);
+    i += (length - i) & ~(size_t)3;
+
+    for (; i < length; ++i) {
+        dst[(dst_addr+i)^S8] = 0;
+    }
+}
+
 unsigned int cart_rom_dma_write(void* opaque, uint8_t* dram, uint32_t dram_addr, uint32_t cart_addr, uint32_t length)
 {
-    size_t i;
     struct cart_rom* cart_rom = (struct cart_rom*)opaque;
     const uint8_t* mem = cart_rom->rom;
+    size_t dram_size = cart_rom->r4300->rdram->dram_size;
+    size_t rom_length;
+    size_t dram_length;
 
     cart_addr &= CART_ROM_ADDR_MASK;
 
-    if (cart_addr + length < cart_rom->rom_size)
-    {
-        for(i = 0; i < length && (dram_addr+i) < cart_rom->r4300->rdram->dram_size; ++i) {
-            dram[(dram_addr+i)^S8] = mem[(cart_addr+i)^S8];
-        }
-    }
-    else
-    {
-        unsigned int diff = (cart_rom->rom_size <= cart_addr)
-            ? 0
-            : cart_rom->rom_size - cart_addr;
+    /* past the end of RDRAM nothing is written */
+    dram_length = (dram_addr < dram_size) ? dram_size - dram_addr : 0;
+    if (dram_length > length)
+        dram_length = length;
 
-        for (i = 0; i < diff && (dram_addr+i) < cart_rom->r4300->rdram->dram_size; ++i) {
-            dram[(dram_addr+i)^S8] = mem[(cart_addr+i)^S8];
-        }
-        for (; i < length && (dram_addr+i) < cart_rom->r4300->rdram->dram_size; ++i) {
-            dram[(dram_addr+i)^S8] = 0;
-        }
-    }
+    /* past the end of ROM, zeroes are read */
+    rom_length = (cart_addr < cart_rom->rom_size) ? cart_rom->rom_size - cart_addr : 0;
+    if (rom_length > dram_length)
+        rom_length = dram_length;
+
+    copy_swizzled(dram, dram_addr, mem, cart_addr, rom_length);
+    clear_swizzled(dram, dram_addr + rom_length, dram_length - rom_length);
 
-    /* invalidate cached code */
-    invalidate_r4300_cached_code(cart_rom->r4300, 0x80000000 + dram_addr, length);
-    invalidate_r4300_cached_code(cart_rom->r4300, 0xa0000000 + dram_addr, length);
+    /* invalidate cached code (a size of 0 would invalidate everything) */
+    if (dram_length > 0) {
+        invalidate_r4300_cached_code(cart_rom->r4300, 0x80000000 + dram_addr, dram_length);
+        invalidate_r4300_cached_code(cart_rom->r4300, 0xa0000000 + dram_addr, dram_length);
+    }
 
     return (length / 8) + add_random_interrupt_time(cart_rom->r4300);
 }
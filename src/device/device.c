@@ -88,12 +88,18 @@ void init_device(struct device* dev,
     int no_compiled_jump,
     int randomize_interrupt,
     uint32_t start_address,
+    const char* block_cache_path,
+    unsigned int new_dynarec_cache_size,
+    unsigned int new_dynarec_cache_size_max,
+    int pure_interp_threaded,
     /* ai */
     void* aout, const struct audio_out_backend_interface* iaout, float dma_modifier,
     /* si */
     unsigned int si_dma_duration,
     /* rdram */
     size_t dram_size,
+    /* rdp */
+    int fb_track_pages,
     /* pif */
     void* jbds[PIF_CHANNELS_COUNT],
     const struct joybus_device_interface* ijbds[PIF_CHANNELS_COUNT],
@@ -183,8 +189,9 @@ void init_device(struct device* dev,
     init_rdram(&dev->rdram, mem_base_u32(base, MM_RDRAM_DRAM), dram_size, &dev->r4300);
 
     init_r4300(&dev->r4300, &dev->mem, &dev->mi, &dev->rdram, interrupt_handlers,
-            emumode, count_per_op, count_per_op_denom_pot, no_compiled_jump, randomize_interrupt, start_address);
-    init_rdp(&dev->dp, &dev->sp, &dev->mi, &dev->mem, &dev->rdram, &dev->r4300);
+            emumode, count_per_op, count_per_op_denom_pot, no_compiled_jump, randomize_interrupt, start_address, block_cache_path,
+            new_dynarec_cache_size, new_dynarec_cache_size_max, pure_interp_threaded);
+    init_rdp(&dev->dp, &dev->sp, &dev->mi, &dev->mem, &dev->rdram, &dev->r4300, fb_track_pages);
     init_rsp(&dev->sp, mem_base_u32(base, MM_RSP_MEM), &dev->mi, &dev->dp, &dev->ri);
     init_ai(&dev->ai, &dev->mi, &dev->ri, &dev->vi, aout, iaout, dma_modifier);
     init_mi(&dev->mi, &dev->r4300);
@@ -125,12 +125,18 @@ void init_device(struct device* dev,
     int no_compiled_jump,
     int randomize_interrupt,
     uint32_t start_address,
+    const char* block_cache_path,
+    unsigned int new_dynarec_cache_size,
+    unsigned int new_dynarec_cache_size_max,
+    int pure_interp_threaded,
     /* ai */
     void* aout, const struct audio_out_backend_interface* iaout, float dma_modifier,
     /* si */
     unsigned int si_dma_duration,
     /* rdram */
     size_t dram_size,
+    /* rdp */
+    int fb_track_pages,
     /* pif */
     void* jbds[PIF_CHANNELS_COUNT],
     const struct joybus_device_interface* ijbds[PIF_CHANNELS_COUNT],
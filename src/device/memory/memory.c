@@ -46,6 +46,29 @@
 #include <malloc.h>
 #endif
 
+/* Return the index of handler in mem->handlers, adding it if it isn't there yet.
+ * Only a few distinct handlers exist, so a linear search is fine. */
+static uint8_t get_handler_index(struct memory* mem, const struct mem_handler* handler)
+{
+    size_t i;
+
+    for (i = 0; i < mem->handlers_count; ++i) {
+        if (mem->handlers[i].opaque == handler->opaque
+         && mem->handlers[i].read32 == handler->read32
+         && mem->handlers[i].write32 == handler->write32) {
+            return (uint8_t)i;
+        }
+    }
+
+    if (mem->handlers_count >= MEM_HANDLERS_MAX) {
+        DebugMessage(M64MSG_ERROR, "Too many memory handlers, mapping ignored");
+        return 0;
+    }
+
+    mem->handlers[mem->handlers_count] = *handler;
+    return (uint8_t)mem->handlers_count++;
+}
+
 #ifdef DBG
 enum
 {
@@ -64,7 +87,7 @@ void read_with_bp_checks(void* opaque, uint32_t address, uint32_t* value)
                 M64P_BKP_FLAG_ENABLED | M64P_BKP_FLAG_READ);
     }
 
-    mem_read32(&r4300->mem->saved_handlers[region], address, value);
+    mem_read32(&r4300->mem->handlers[r4300->mem->saved_handler_index[region]], address, value);
 }
 
 void write_with_bp_checks(void* opaque, uint32_t address, uint32_t value, uint32_t mask)
@@ -78,21 +101,20 @@ void write_with_bp_checks(void* opaque, uint32_t address, uint32_t value, uint32
                 M64P_BKP_FLAG_ENABLED | M64P_BKP_FLAG_WRITE);
     }
 
-    mem_write32(&r4300->mem->saved_handlers[region], address, value, mask);
+    mem_write32(&r4300->mem->handlers[r4300->mem->saved_handler_index[region]], address, value, mask);
 }
 
 void activate_memory_break_read(struct memory* mem, uint32_t address)
 {
     uint16_t region = address >> 16;
-    struct mem_handler* dbg_handler = &mem->dbg_handler;
-    struct mem_handler* handler = &mem->handlers[region];
-    struct mem_handler* saved_handler = &mem->saved_handlers[region];
+    uint8_t* handler = &mem->handler_index[region];
+    uint8_t* saved_handler = &mem->saved_handler_index[region];
     unsigned char* bp_check = &mem->bp_checks[region];
 
     /* if neither read nor write bp is active, set dbg_handler */
     if (!(*bp_check & (BP_CHECK_READ | BP_CHECK_WRITE))) {
         *saved_handler = *handler;
-        *handler = *dbg_handler;
+        *handler = mem->dbg_handler_index;
     }
 
     /* activate bp read */
@@ -102,8 +124,8 @@ void activate_memory_break_read(struct memory* mem, uint32_t address)
 void deactivate_memory_break_read(struct memory* mem, uint32_t address)
 {
     uint16_t region = address >> 16;
-    struct mem_handler* handler = &mem->handlers[region];
-    struct mem_handler* saved_handler = &mem->saved_handlers[region];
+    uint8_t* handler = &mem->handler_index[region];
+    uint8_t* saved_handler = &mem->saved_handler_index[region];
     unsigned char* bp_check = &mem->bp_checks[region];
 
     /* desactivate bp read */
@@ -118,15 +140,14 @@ void deactivate_memory_break_read(struct memory* mem, uint32_t address)
 void activate_memory_break_write(struct memory* mem, uint32_t address)
 {
     uint16_t region = address >> 16;
-    struct mem_handler* dbg_handler = &mem->dbg_handler;
-    struct mem_handler* handler = &mem->handlers[region];
-    struct mem_handler* saved_handler = &mem->saved_handlers[region];
+    uint8_t* handler = &mem->handler_index[region];
+    uint8_t* saved_handler = &mem->saved_handler_index[region];
     unsigned char* bp_check = &mem->bp_checks[region];
 
     /* if neither read nor write bp is active, set dbg_handler */
     if (!(*bp_check & (BP_CHECK_READ | BP_CHECK_WRITE))) {
         *saved_handler = *handler;
-        *handler = *dbg_handler;
+        *handler = mem->dbg_handler_index;
     }
 
     /* activate bp write */
@@ -136,8 +157,8 @@ void activate_memory_break_write(struct memory* mem, uint32_t address)
 void deactivate_memory_break_write(struct memory* mem, uint32_t address)
 {
     uint16_t region = address >> 16;
-    struct mem_handler* handler = &mem->handlers[region];
-    struct mem_handler* saved_handler = &mem->saved_handlers[region];
+    uint8_t* handler = &mem->handler_index[region];
+    uint8_t* saved_handler = &mem->saved_handler_index[region];
     unsigned char* bp_check = &mem->bp_checks[region];
 
     /* desactivate bp write */
@@ -170,9 +191,11 @@ void init_memory(struct memory* mem,
 {
     size_t m;
 
+    mem->handlers_count = 0;
+
 #ifdef DBG
     memset(mem->bp_checks, 0, 0x10000*sizeof(mem->bp_checks[0]));
-    memcpy(&mem->dbg_handler, dbg_handler, sizeof(*dbg_handler));
+    mem->dbg_handler_index = get_handler_index(mem, dbg_handler);
 #endif
 
     mem->base = base;
@@ -185,24 +208,24 @@ void init_memory(struct memory* mem,
 static void map_region(struct memory* mem,
                        uint16_t region,
                        int type,
-                       const struct mem_handler* handler)
+                       uint8_t handler)
 {
 #ifdef DBG
     /* set region type */
-    mem->memtype[region] = type;
+    mem->memtype[region] = (unsigned char)type;
 
     /* set handler */
     if (lookup_breakpoint(((uint32_t)region << 16), 0x10000,
                           M64P_BKP_FLAG_ENABLED) != -1)
     {
-        mem->saved_handlers[region] = *handler;
-        mem->handlers[region] = mem->dbg_handler;
+        mem->saved_handler_index[region] = handler;
+        mem->handler_index[region] = mem->dbg_handler_index;
     }
     else
 #endif
     {
         (void)type;
-        mem->handlers[region] = *handler;
+        mem->handler_index[region] = handler;
     }
 }
 
@@ -211,9 +234,10 @@ void apply_mem_mapping(struct memory* mem, const struct mem_mapping* mapping)
     size_t i;
     uint16_t begin = mapping->begin >> 16;
     uint16_t end   = mapping->end   >> 16;
+    uint8_t handler = get_handler_index(mem, &mapping->handler);
 
     for (i = begin; i <= end; ++i) {
-        map_region(mem, i, mapping->type, &mapping->handler);
+        map_region(mem, i, mapping->type, handler);
     }
 }
 
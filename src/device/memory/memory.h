@@ -49,16 +49,23 @@ struct mem_mapping
     struct mem_handler handler;
 };
 
+/* Maximum number of distinct handlers, handler_index entries are 8-bit */
+enum { MEM_HANDLERS_MAX = 0x100 };
+
 struct memory
 {
-    struct mem_handler handlers[0x10000];
+    /* handler of each 64KB region, as an index into handlers */
+    uint8_t handler_index[0x10000];
+    /* deduplicated handlers, filled as mappings are applied */
+    struct mem_handler handlers[MEM_HANDLERS_MAX];
+    size_t handlers_count;
     void* base;
 
 #ifdef DBG
-    int memtype[0x10000];
+    unsigned char memtype[0x10000];
     unsigned char bp_checks[0x10000];
-    struct mem_handler saved_handlers[0x10000];
-    struct mem_handler dbg_handler;
+    uint8_t saved_handler_index[0x10000];
+    uint8_t dbg_handler_index;
 #endif
 };
 
@@ -74,7 +81,7 @@ void init_memory(struct memory* mem,
 
 static osal_inline const struct mem_handler* mem_get_handler(const struct memory* mem, uint32_t address)
 {
-    return &mem->handlers[address >> 16];
+    return &mem->handlers[mem->handler_index[address >> 16]];
 }
 
 static osal_inline void mem_read32(const struct mem_handler* handler, uint32_t address, uint32_t* value)
@@ -35,12 +35,179 @@
 #include "device/r4300/r4300_core.h"
 #include "device/r4300/idec.h"
 #include "main/main.h"
+#include "main/rom.h"
 #include "osal/preproc.h"
 
 #ifdef DBG
 #include "debugger/dbg_debugger.h"
 #endif
 
+// -----------------------------------------------------------
+// Hot path traces.
+// Jump targets are counted when entered and once one gets hot, the path
+// taken from there is recorded. Later executions of the trace dispatch the
+// recorded instructions in a tight loop, deferring the cycle count check of
+// the jumps to the trace exit. Every step is guarded by the expected pc, so
+// leaving the recorded path just ends the trace.
+// -----------------------------------------------------------
+#define TRACE_HOT_THRESHOLD 32
+#define TRACE_MAX_LENGTH 64
+
+struct cached_interp_trace
+{
+    struct precomp_instr* head;     /* NULL once dropped */
+    void (*head_ops)(void);         /* ops replaced by cached_interp_TRACE */
+    int recording;
+    unsigned int length;
+    struct precomp_instr* path[TRACE_MAX_LENGTH];
+};
+
+static void free_traces(struct precomp_block* block, struct cached_interp_trace* running)
+{
+    int i, length;
+
+    if (block->traces == NULL)
+        return;
+
+    length = get_block_length(block);
+    for (i = 0; i < length; ++i)
+    {
+        struct cached_interp_trace* trace = block->traces[i];
+        if (trace == NULL)
+            continue;
+
+        if (trace->head->ops == cached_interp_TRACE)
+            trace->head->ops = trace->head_ops;
+
+        /* the running trace is freed when it exits */
+        if (trace == running)
+            trace->head = NULL;
+        else
+            free(trace);
+    }
+
+    free(block->traces);
+    free(block->hits);
+    block->traces = NULL;
+    block->hits = NULL;
+}
+
+static void count_trace_entry(struct precomp_block* block, struct precomp_instr* inst)
+{
+    size_t i = inst - block->block;
+    struct cached_interp_trace* trace;
+
+    if (block->traces == NULL)
+    {
+        int length = get_block_length(block);
+        block->traces = calloc(length, sizeof(block->traces[0]));
+        block->hits = calloc(length, sizeof(block->hits[0]));
+        if (block->traces == NULL || block->hits == NULL)
+        {
+            free(block->traces);
+            free(block->hits);
+            block->traces = NULL;
+            block->hits = NULL;
+            return;
+        }
+    }
+
+    if (block->traces[i] != NULL || ++block->hits[i] < TRACE_HOT_THRESHOLD)
+        return;
+
+    block->hits[i] = 0;
+
+    /* the path is recorded from decoded instructions only */
+    if (inst->ops == cached_interp_NOTCOMPILED || inst->ops == cached_interp_NOTCOMPILED2)
+        return;
+
+    trace = malloc(sizeof(*trace));
+    if (trace == NULL)
+        return;
+
+    trace->head = inst;
+    trace->head_ops = inst->ops;
+    trace->recording = 1;
+    trace->length = 0;
+
+    block->traces[i] = trace;
+    inst->ops = cached_interp_TRACE;
+}
+
+static void record_trace(struct r4300_core* r4300, struct cached_interp_trace* trace)
+{
+    struct precomp_instr** pc = r4300_pc_struct(r4300);
+    unsigned int length = 0;
+
+    trace->head_ops();
+
+    /* stop before any pending interrupt so that it is taken on time */
+    while (*pc != trace->head
+        && length < TRACE_MAX_LENGTH
+        && trace->head != NULL
+        && *r4300_cp0_cycle_count(&r4300->cp0) < 0
+        && !*r4300_stop(r4300))
+    {
+        trace->path[length++] = *pc;
+        (*pc)->ops();
+    }
+
+    /* otherwise try again next time */
+    if (*pc == trace->head || length == TRACE_MAX_LENGTH)
+    {
+        trace->length = length;
+        trace->recording = 0;
+    }
+}
+
+void cached_interp_TRACE(void)
+{
+    struct r4300_core* r4300 = &g_dev.r4300;
+    struct cached_interp* const cinterp = &r4300->cached_interp;
+    struct precomp_instr** pc = r4300_pc_struct(r4300);
+    struct precomp_instr* const head = *pc;
+    struct cached_interp_trace* const trace = cinterp->actual->traces[head - cinterp->actual->block];
+    unsigned int i;
+
+    assert(trace != NULL && trace->head == head);
+
+    if (r4300->delay_slot || cinterp->trace != NULL
+#ifdef DBG
+     || g_DebuggerActive
+#endif
+       )
+    {
+        trace->head_ops();
+        return;
+    }
+
+    cinterp->trace = trace;
+
+    if (trace->recording)
+    {
+        record_trace(r4300, trace);
+    }
+    else
+    {
+        do
+        {
+            trace->head_ops();
+            for (i = 0; i < trace->length && *pc == trace->path[i]; ++i)
+                trace->path[i]->ops();
+        } while (*pc == head
+              && trace->head != NULL
+              && *r4300_cp0_cycle_count(&r4300->cp0) < 0
+              && !*r4300_stop(r4300));
+    }
+
+    cinterp->trace = NULL;
+
+    if (trace->head == NULL)
+        free(trace);
+
+    if (*r4300_cp0_cycle_count(&r4300->cp0) >= 0) gen_interrupt(r4300);
+}
+
 // -----------------------------------------------------------
 // Cached interpreter functions (and fallback for dynarec).
 // -----------------------------------------------------------
@@ -89,6 +256,8 @@ void cached_interp_##name(void) \
         if (take_jump && !r4300->skip_jump) \
         { \
             (*r4300_pc_struct(r4300))=r4300->cached_interp.actual->block+((jump_target-r4300->cached_interp.actual->start)>>2); \
+            if (r4300->cached_interp.trace_enabled && r4300->cached_interp.trace == NULL) \
+                count_trace_entry(r4300->cached_interp.actual, *r4300_pc_struct(r4300)); \
         } \
     } \
     else \
@@ -97,7 +266,8 @@ void cached_interp_##name(void) \
         cp0_update_count(r4300); \
     } \
     r4300->cp0.last_addr = *r4300_pc(r4300); \
-    if (*r4300_cp0_cycle_count(&r4300->cp0) >= 0) gen_interrupt(r4300); \
+    if (*r4300_cp0_cycle_count(&r4300->cp0) >= 0 \
+     && (r4300->cached_interp.trace == NULL || r4300->skip_jump)) gen_interrupt(r4300); \
 } \
  \
 void cached_interp_##name##_OUT(void) \
@@ -130,7 +300,8 @@ void cached_interp_##name##_OUT(void) \
         cp0_update_count(r4300); \
     } \
     r4300->cp0.last_addr = *r4300_pc(r4300); \
-    if (*r4300_cp0_cycle_count(&r4300->cp0) >= 0) gen_interrupt(r4300); \
+    if (*r4300_cp0_cycle_count(&r4300->cp0) >= 0 \
+     && (r4300->cached_interp.trace == NULL || r4300->skip_jump)) gen_interrupt(r4300); \
 } \
   \
 void cached_interp_##name##_IDLE(void) \
@@ -188,6 +359,418 @@ void cached_interp_##name##_IDLE(void) \
 
 #include "mips_instructions.def"
 
+// -----------------------------------------------------------
+// Fused instruction pairs.
+// The first instruction of a common idiom gets a handler running both
+// instructions, saving one dispatch. The second instruction keeps its own
+// handler so that jumping onto it still works, and only the first one runs
+// when the pair is entered as a delay slot.
+// -----------------------------------------------------------
+#ifdef DBG
+#define COUNT_FUSION_HIT(r4300) ++(r4300)->cached_interp.fusion_hits
+#else
+#define COUNT_FUSION_HIT(r4300)
+#endif
+
+#define DECLARE_FUSED(first, second) \
+static void cached_interp_##first##_##second(void) \
+{ \
+    DECLARE_R4300 \
+    cached_interp_##first(); \
+    if (r4300->delay_slot) return; \
+    COUNT_FUSION_HIT(r4300); \
+    cached_interp_##second(); \
+}
+
+DECLARE_FUSED(LUI, ADDIU)
+DECLARE_FUSED(LUI, ORI)
+DECLARE_FUSED(LUI, LW)
+DECLARE_FUSED(LUI, SW)
+DECLARE_FUSED(SLT, BNE)
+DECLARE_FUSED(SLT, BNE_OUT)
+DECLARE_FUSED(SLT, BEQ)
+DECLARE_FUSED(SLT, BEQ_OUT)
+DECLARE_FUSED(SLTU, BNE)
+DECLARE_FUSED(SLTU, BNE_OUT)
+DECLARE_FUSED(SLTU, BEQ)
+DECLARE_FUSED(SLTU, BEQ_OUT)
+
+#undef DECLARE_FUSED
+
+static void (*fused_lui_ops(const struct precomp_instr* inst, const struct precomp_instr* next))(void)
+{
+    /* only when the second instruction uses the loaded upper half */
+    if (next->f.i.rs != inst->f.i.rt)
+        return NULL;
+
+    if (next->ops == cached_interp_ADDIU) return cached_interp_LUI_ADDIU;
+    if (next->ops == cached_interp_ORI) return cached_interp_LUI_ORI;
+    if (next->ops == cached_interp_LW) return cached_interp_LUI_LW;
+    if (next->ops == cached_interp_SW) return cached_interp_LUI_SW;
+    return NULL;
+}
+
+static void (*fused_slt_ops(const struct precomp_instr* inst, const struct precomp_instr* next))(void)
+{
+    int is_sltu = (inst->ops == cached_interp_SLTU);
+
+    /* only when the branch tests the comparison result */
+    if (next->f.i.rs != inst->f.r.rd && next->f.i.rt != inst->f.r.rd)
+        return NULL;
+
+    if (next->ops == cached_interp_BNE) return is_sltu ? cached_interp_SLTU_BNE : cached_interp_SLT_BNE;
+    if (next->ops == cached_interp_BNE_OUT) return is_sltu ? cached_interp_SLTU_BNE_OUT : cached_interp_SLT_BNE_OUT;
+    if (next->ops == cached_interp_BEQ) return is_sltu ? cached_interp_SLTU_BEQ : cached_interp_SLT_BEQ;
+    if (next->ops == cached_interp_BEQ_OUT) return is_sltu ? cached_interp_SLTU_BEQ_OUT : cached_interp_SLT_BEQ_OUT;
+    return NULL;
+}
+
+/* Fuse the idioms found among the instructions [first, last) of a freshly decoded block */
+static void fuse_instructions(struct r4300_core* r4300, struct precomp_block* block, int first, int last)
+{
+    int i;
+    int length = get_block_length(block);
+    void (*fused)(void);
+
+#if defined(COMPARE_CORE)
+    /* instructions have to be compared one by one */
+    return;
+#elif defined(DBG)
+    if (g_DebuggerActive) { return; }
+#endif
+
+    if (last > length) { last = length; }
+
+    for (i = first; i + 1 < last; ++i)
+    {
+        struct precomp_instr* inst = block->block + i;
+        const struct precomp_instr* next = inst + 1;
+
+        if (inst->ops == cached_interp_LUI)
+            fused = fused_lui_ops(inst, next);
+        else if (inst->ops == cached_interp_SLT || inst->ops == cached_interp_SLTU)
+            fused = fused_slt_ops(inst, next);
+        else
+            continue;
+
+        if (fused != NULL)
+        {
+            inst->ops = fused;
+            ++r4300->cached_interp.fused_pairs;
+        }
+    }
+}
+
+// -----------------------------------------------------------
+// Idle loops.
+// Short backward loops made of loads and register arithmetic only, without
+// values carried from one iteration to the next, do the same thing on every
+// iteration until memory changes, which only an event can do. Once a whole
+// iteration has run, their branch skips the count register to the next
+// event instead of spinning until it. Loads are checked at runtime, as the
+// VI and AI registers do change with the count register.
+// -----------------------------------------------------------
+#define IDLE_LOOP_MAX_LENGTH 16
+
+struct cached_interp_idle_loop
+{
+    void (*branch_ops)(void);       /* ops replaced by cached_interp_IDLE_LOOP */
+    uint32_t start;                 /* address of the first instruction of the loop */
+    unsigned int load_count;
+    const struct precomp_instr* loads[IDLE_LOOP_MAX_LENGTH];
+};
+
+static void free_idle_loops(struct precomp_block* block)
+{
+    int i, length;
+
+    if (block->idle_loops == NULL)
+        return;
+
+    length = get_block_length(block);
+    for (i = 0; i < length; ++i)
+        free(block->idle_loops[i]);
+
+    free(block->idle_loops);
+    block->idle_loops = NULL;
+}
+
+static uint32_t reg_mask(struct r4300_core* r4300, const int64_t* reg)
+{
+    return UINT32_C(1) << (reg - r4300_regs(r4300));
+}
+
+/* Get the registers read and written by an instruction allowed in an idle loop */
+static int idle_loop_instruction(struct r4300_core* r4300, const struct precomp_instr* inst,
+    uint32_t* reads, uint32_t* writes, int* is_load)
+{
+    void (*const ops)(void) = inst->ops;
+
+    *reads = *writes = 0;
+    *is_load = 0;
+
+    if (ops == cached_interp_NOP)
+        return 1;
+
+    if (ops == cached_interp_LUI)
+    {
+        *writes = reg_mask(r4300, inst->f.i.rt);
+        return 1;
+    }
+
+    if (ops == cached_interp_LB || ops == cached_interp_LBU
+     || ops == cached_interp_LH || ops == cached_interp_LHU
+     || ops == cached_interp_LW || ops == cached_interp_LWU
+     || ops == cached_interp_LD)
+    {
+        *reads = reg_mask(r4300, inst->f.i.rs);
+        *writes = reg_mask(r4300, inst->f.i.rt);
+        *is_load = 1;
+        return 1;
+    }
+
+    if (ops == cached_interp_ADDIU || ops == cached_interp_DADDIU
+     || ops == cached_interp_ANDI || ops == cached_interp_ORI
+     || ops == cached_interp_XORI || ops == cached_interp_SLTI
+     || ops == cached_interp_SLTIU)
+    {
+        *reads = reg_mask(r4300, inst->f.i.rs);
+        *writes = reg_mask(r4300, inst->f.i.rt);
+        return 1;
+    }
+
+    if (ops == cached_interp_SLL || ops == cached_interp_SRL
+     || ops == cached_interp_SRA || ops == cached_interp_DSLL
+     || ops == cached_interp_DSRL || ops == cached_interp_DSRA
+     || ops == cached_interp_DSLL32 || ops == cached_interp_DSRL32
+     || ops == cached_interp_DSRA32)
+    {
+        *reads = reg_mask(r4300, inst->f.r.rt);
+        *writes = reg_mask(r4300, inst->f.r.rd);
+        return 1;
+    }
+
+    if (ops == cached_interp_ADDU || ops == cached_interp_DADDU
+     || ops == cached_interp_SUBU || ops == cached_interp_DSUBU
+     || ops == cached_interp_AND || ops == cached_interp_OR
+     || ops == cached_interp_XOR || ops == cached_interp_NOR
+     || ops == cached_interp_SLT || ops == cached_interp_SLTU
+     || ops == cached_interp_SLLV || ops == cached_interp_SRLV
+     || ops == cached_interp_SRAV || ops == cached_interp_DSLLV
+     || ops == cached_interp_DSRLV || ops == cached_interp_DSRAV)
+    {
+        *reads = reg_mask(r4300, inst->f.r.rs) | reg_mask(r4300, inst->f.r.rt);
+        *writes = reg_mask(r4300, inst->f.r.rd);
+        return 1;
+    }
+
+    return 0;
+}
+
+/* Returns the index of the target of the in-block backward jump at index i, or -1 */
+static int idle_loop_target(struct r4300_core* r4300, const struct precomp_block* block, int i, uint32_t* reads)
+{
+    const struct precomp_instr* const inst = block->block + i;
+    void (*const ops)(void) = inst->ops;
+    uint32_t target;
+
+    if (ops == cached_interp_J)
+    {
+        *reads = 0;
+        target = (inst->addr & ~UINT32_C(0xfffffff)) | (inst->f.j.inst_index << 2);
+        if (target < block->start || target > inst->addr)
+            return -1;
+        return (target - block->start) / 4;
+    }
+
+    if (ops == cached_interp_BEQ || ops == cached_interp_BEQL
+     || ops == cached_interp_BNE || ops == cached_interp_BNEL)
+        *reads = reg_mask(r4300, inst->f.i.rs) | reg_mask(r4300, inst->f.i.rt);
+    else if (ops == cached_interp_BLEZ || ops == cached_interp_BLEZL
+          || ops == cached_interp_BGTZ || ops == cached_interp_BGTZL
+          || ops == cached_interp_BLTZ || ops == cached_interp_BLTZL
+          || ops == cached_interp_BGEZ || ops == cached_interp_BGEZL)
+        *reads = reg_mask(r4300, inst->f.i.rs);
+    else
+        return -1;
+
+    /* the non OUT variants jump inside the block */
+    if (inst->f.i.immediate >= 0)
+        return -1;
+    return i + 1 + inst->f.i.immediate;
+}
+
+/* Check the loop closed by the jump at index i, filling loop if it is idle */
+static int analyze_idle_loop(struct r4300_core* r4300, const struct precomp_block* block, int i,
+    struct cached_interp_idle_loop* loop)
+{
+    uint32_t reads[IDLE_LOOP_MAX_LENGTH], writes[IDLE_LOOP_MAX_LENGTH];
+    int is_load[IDLE_LOOP_MAX_LENGTH];
+    uint32_t branch_reads;
+    uint32_t written = 0, other_written = 0, lui_written = 0, lui_twice = 0;
+    uint32_t defined = 0, bases = 0;
+    int k, n, target;
+
+    target = idle_loop_target(r4300, block, i, &branch_reads);
+    if (target < 0 || i + 2 - target > IDLE_LOOP_MAX_LENGTH)
+        return 0;
+
+    /* the loop instructions, up to the delay slot */
+    n = i + 2 - target;
+    for (k = 0; k < n; ++k)
+    {
+        const struct precomp_instr* inst = block->block + target + k;
+
+        if (target + k == i)
+        {
+            reads[k] = branch_reads;
+            writes[k] = 0;
+            is_load[k] = 0;
+            continue;
+        }
+
+        if (!idle_loop_instruction(r4300, inst, &reads[k], &writes[k], &is_load[k]))
+            return 0;
+
+        if (inst->ops == cached_interp_LUI)
+        {
+            lui_twice |= lui_written & writes[k];
+            lui_written |= writes[k];
+        }
+        else
+        {
+            other_written |= writes[k];
+        }
+        written |= writes[k];
+    }
+
+    loop->start = block->start + target * 4;
+    loop->load_count = 0;
+
+    for (k = 0; k < n; ++k)
+    {
+        /* a value read before being written comes from the previous iteration */
+        if (reads[k] & written & ~defined)
+            return 0;
+        defined |= writes[k];
+
+        if (is_load[k])
+        {
+            const struct precomp_instr* inst = block->block + target + k;
+            bases |= reg_mask(r4300, inst->f.i.rs);
+            loop->loads[loop->load_count++] = inst;
+        }
+    }
+
+    /* load addresses are recomputed at the branch from their base register */
+    if (bases & (other_written | lui_twice))
+        return 0;
+
+    loop->branch_ops = block->block[i].ops;
+    return 1;
+}
+
+/* Detect the idle loops ending among the instructions [first, last) of a freshly decoded block */
+static void detect_idle_loops(struct r4300_core* r4300, struct precomp_block* block, int first, int last)
+{
+    int i;
+    int length = get_block_length(block);
+    struct cached_interp_idle_loop candidate;
+
+#if defined(COMPARE_CORE)
+    /* the pure interpreter doesn't skip cycles */
+    return;
+#elif defined(DBG)
+    if (g_DebuggerActive) { return; }
+#endif
+
+    /* keep the delay slot in the block */
+    if (last > length - 1) { last = length - 1; }
+
+    for (i = first; i < last; ++i)
+    {
+        struct precomp_instr* inst = block->block + i;
+
+        if (!analyze_idle_loop(r4300, block, i, &candidate))
+            continue;
+
+        if (block->idle_loops == NULL)
+        {
+            block->idle_loops = calloc(length, sizeof(block->idle_loops[0]));
+            if (block->idle_loops == NULL)
+                return;
+        }
+
+        if (block->idle_loops[i] == NULL)
+        {
+            block->idle_loops[i] = malloc(sizeof(candidate));
+            if (block->idle_loops[i] == NULL)
+                continue;
+
+            ++r4300->cached_interp.idle_loops;
+            DebugMessage(M64MSG_VERBOSE, "Idle loop detected at %08" PRIX32 "-%08" PRIX32,
+                candidate.start, inst->addr + 4);
+        }
+
+        *block->idle_loops[i] = candidate;
+        inst->ops = cached_interp_IDLE_LOOP;
+    }
+}
+
+static int idle_loop_loads(struct r4300_core* r4300, const struct cached_interp_idle_loop* loop)
+{
+    unsigned int k;
+
+    for (k = 0; k < loop->load_count; ++k)
+    {
+        const struct precomp_instr* inst = loop->loads[k];
+        uint32_t address = (uint32_t)*inst->f.i.rs + (int32_t)inst->f.i.immediate;
+
+        /* TLB mapped addresses aren't worth translating here */
+        if ((address & UINT32_C(0xc0000000)) != UINT32_C(0x80000000))
+            return 0;
+
+        /* VI_CURRENT_REG and AI_LEN_REG change with the count register,
+         * cartridge and 64DD registers aren't known to be stable */
+        address &= UINT32_C(0x1fffffff);
+        if (address >= MM_VI_REGS && address < MM_PI_REGS)
+            return 0;
+        if (address >= MM_DOM2_ADDR1)
+            return 0;
+    }
+
+    return 1;
+}
+
+void cached_interp_IDLE_LOOP(void)
+{
+    DECLARE_R4300
+    struct precomp_block* block = r4300->cached_interp.actual;
+    struct precomp_instr** pc = r4300_pc_struct(r4300);
+    const struct cached_interp_idle_loop* loop = block->idle_loops[*pc - block->block];
+    uint32_t* cp0_regs = r4300_cp0_regs(&r4300->cp0);
+    int* cp0_cycle_count = r4300_cp0_cycle_count(&r4300->cp0);
+    const uint32_t start = loop->start;
+
+    /* the branch may free the loop, through a state load for instance */
+    const int idle = !r4300->delay_slot
+        && r4300->cp0.last_addr == start
+        && idle_loop_loads(r4300, loop);
+
+    loop->branch_ops();
+
+    /* still looping, with an iteration like the next ones */
+    if (idle && (*pc)->addr == start && *cp0_cycle_count < 0)
+    {
+        ++r4300->cached_interp.idle_loop_skips;
+        r4300->cached_interp.idle_loop_cycles -= *cp0_cycle_count;
+        cp0_regs[CP0_COUNT_REG] -= *cp0_cycle_count;
+        *cp0_cycle_count = 0;
+
+        if (r4300->cached_interp.trace == NULL) gen_interrupt(r4300);
+    }
+}
+
 // -----------------------------------------------------------
 // Flow control 'fake' instructions
 // -----------------------------------------------------------
@@ -231,7 +814,8 @@ Used by dynarec only, check should be unnecessary
 void cached_interp_NOTCOMPILED(void)
 {
     DECLARE_R4300
-    uint32_t *mem = fast_mem_access(r4300, r4300->cached_interp.blocks[*r4300_pc(r4300)>>12]->start);
+    struct precomp_block* block = cached_interp_get_block(&r4300->cached_interp, *r4300_pc(r4300));
+    uint32_t *mem = fast_mem_access(r4300, block->start);
 #ifdef DBG
     DebugMessage(M64MSG_INFO, "NOTCOMPILED: addr = %x ops = %lx", *r4300_pc(r4300), (long) (*r4300_pc_struct(r4300))->ops);
 #endif
@@ -240,7 +824,7 @@ void cached_interp_NOTCOMPILED(void)
         DebugMessage(M64MSG_ERROR, "not compiled exception");
     }
     else {
-        r4300->cached_interp.recompile_block(r4300, mem, r4300->cached_interp.blocks[*r4300_pc(r4300) >> 12], *r4300_pc(r4300));
+        r4300->cached_interp.recompile_block(r4300, mem, block, *r4300_pc(r4300));
     }
 
 /*
@@ -698,15 +1282,15 @@ enum r4300_opcode r4300_decode(struct precomp_instr* inst, struct r4300_core* r4
 
 static uint32_t update_invalid_addr(struct r4300_core* r4300, uint32_t addr)
 {
-    char* const invalid_code = r4300->cached_interp.invalid_code;
+    struct cached_interp* const cinterp = &r4300->cached_interp;
 
     if ((addr & UINT32_C(0xc0000000)) == UINT32_C(0x80000000))
     {
-        if (invalid_code[addr>>12]) {
-            invalid_code[(addr^0x20000000)>>12] = 1;
+        if (cached_interp_invalid_code(cinterp, addr>>12)) {
+            cached_interp_set_invalid_code(cinterp, (addr^0x20000000)>>12, 1);
         }
-        if (invalid_code[(addr^0x20000000)>>12]) {
-            invalid_code[addr>>12] = 1;
+        if (cached_interp_invalid_code(cinterp, (addr^0x20000000)>>12)) {
+            cached_interp_set_invalid_code(cinterp, addr>>12, 1);
         }
         return addr;
     }
@@ -719,23 +1303,77 @@ static uint32_t update_invalid_addr(struct r4300_core* r4300, uint32_t addr)
 
             update_invalid_addr(r4300, paddr);
 
-            if (invalid_code[(beg_paddr+0x000)>>12]) {
-                invalid_code[addr>>12] = 1;
+            if (cached_interp_invalid_code(cinterp, (beg_paddr+0x000)>>12)) {
+                cached_interp_set_invalid_code(cinterp, addr>>12, 1);
             }
-            if (invalid_code[(beg_paddr+0xffc)>>12]) {
-                invalid_code[addr>>12] = 1;
+            if (cached_interp_invalid_code(cinterp, (beg_paddr+0xffc)>>12)) {
+                cached_interp_set_invalid_code(cinterp, addr>>12, 1);
             }
-            if (invalid_code[addr>>12]) {
-                invalid_code[(beg_paddr+0x000)>>12] = 1;
+            if (cached_interp_invalid_code(cinterp, addr>>12)) {
+                cached_interp_set_invalid_code(cinterp, (beg_paddr+0x000)>>12, 1);
             }
-            if (invalid_code[addr>>12]) {
-                invalid_code[(beg_paddr+0xffc)>>12] = 1;
+            if (cached_interp_invalid_code(cinterp, addr>>12)) {
+                cached_interp_set_invalid_code(cinterp, (beg_paddr+0xffc)>>12, 1);
             }
         }
         return paddr;
     }
 }
 
+// -----------------------------------------------------------
+// Block instructions arena.
+// Every block spans a 4KB page so all the instruction arrays have the same
+// size. They are carved out of slabs and, as blocks are never freed while
+// emulating, only released all at once by free_blocks.
+// -----------------------------------------------------------
+#define SLAB_ARRAYS 8
+
+struct cached_interp_slab
+{
+    struct cached_interp_slab* next;
+    /* followed by SLAB_ARRAYS instruction arrays */
+};
+
+static struct precomp_instr* alloc_block_instrs(struct cached_interp* cinterp, size_t memsize)
+{
+    struct cached_interp_slab* slab;
+
+    if (cinterp->slab_free == 0)
+    {
+        slab = malloc(sizeof(*slab) + SLAB_ARRAYS * memsize);
+        if (slab == NULL)
+            return NULL;
+
+        slab->next = cinterp->slabs;
+        cinterp->slabs = slab;
+        cinterp->slab_free = SLAB_ARRAYS;
+    }
+
+    slab = cinterp->slabs;
+    --cinterp->slab_free;
+    return (struct precomp_instr*)((unsigned char*)(slab + 1) + (SLAB_ARRAYS - 1 - cinterp->slab_free) * memsize);
+}
+
+static void free_block_slabs(struct cached_interp* cinterp)
+{
+    while (cinterp->slabs != NULL)
+    {
+        struct cached_interp_slab* next = cinterp->slabs->next;
+        free(cinterp->slabs);
+        cinterp->slabs = next;
+    }
+    cinterp->slab_free = 0;
+}
+
+static void invalidate_all_code(struct cached_interp* cinterp)
+{
+#if defined(CACHED_INTERP_INVALID_CODE_BITMAP)
+    memset(cinterp->invalid_code, 0xff, sizeof(cinterp->invalid_code));
+#else
+    memset(cinterp->invalid_code, 1, sizeof(cinterp->invalid_code));
+#endif
+}
+
 int get_block_length(const struct precomp_block *block)
 {
     return (block->end-block->start)/4;
@@ -751,7 +1389,12 @@ void cached_interp_init_block(struct r4300_core* r4300, uint32_t address)
 {
     int i, length;
 
-    struct precomp_block** block = &r4300->cached_interp.blocks[address >> 12];
+    struct precomp_block** block = cached_interp_block_slot(&r4300->cached_interp, address);
+
+    if (block == NULL) {
+        DebugMessage(M64MSG_ERROR, "Memory error: couldn't allocate memory for cached interpreter.");
+        return;
+    }
 
     /* allocate block */
     if (*block == NULL) {
@@ -759,12 +1402,18 @@ void cached_interp_init_block(struct r4300_core* r4300, uint32_t address)
         (*block)->block = NULL;
         (*block)->start = address & ~UINT32_C(0xfff);
         (*block)->end = (address & ~UINT32_C(0xfff)) + 0x1000;
+        (*block)->hits = NULL;
+        (*block)->traces = NULL;
+        (*block)->idle_loops = NULL;
     }
 
     struct precomp_block* b = *block;
 
     length = get_block_length(b);
 
+    free_traces(b, r4300->cached_interp.trace);
+    free_idle_loops(b);
+
 #ifdef DBG
     DebugMessage(M64MSG_INFO, "init block %" PRIX32 " - %" PRIX32, b->start, b->end);
 #endif
@@ -773,7 +1422,7 @@ void cached_interp_init_block(struct r4300_core* r4300, uint32_t address)
     if (!b->block)
     {
         size_t memsize = get_block_memsize(b);
-        b->block = (struct precomp_instr*)malloc(memsize);
+        b->block = alloc_block_instrs(&r4300->cached_interp, memsize);
         if (!b->block) {
             DebugMessage(M64MSG_ERROR, "Memory error: couldn't allocate memory for cached interpreter.");
             return;
@@ -792,26 +1441,26 @@ void cached_interp_init_block(struct r4300_core* r4300, uint32_t address)
     /* here we're marking the block as a valid code even if it's not compiled
      * yet as the game should have already set up the code correctly.
      */
-    r4300->cached_interp.invalid_code[b->start>>12] = 0;
+    cached_interp_set_invalid_code(&r4300->cached_interp, b->start>>12, 0);
 
 
     if (b->end < UINT32_C(0x80000000) || b->start >= UINT32_C(0xc0000000))
     {
         uint32_t paddr = virtual_to_physical_address(r4300, b->start, 2);
 
-        r4300->cached_interp.invalid_code[paddr>>12] = 0;
+        cached_interp_set_invalid_code(&r4300->cached_interp, paddr>>12, 0);
         cached_interp_init_block(r4300, paddr);
 
         paddr += b->end - b->start - 4;
 
-        r4300->cached_interp.invalid_code[paddr>>12] = 0;
+        cached_interp_set_invalid_code(&r4300->cached_interp, paddr>>12, 0);
         cached_interp_init_block(r4300, paddr);
     }
     else
     {
         uint32_t alt_addr = b->start ^ UINT32_C(0x20000000);
 
-        if (r4300->cached_interp.invalid_code[alt_addr>>12])
+        if (cached_interp_invalid_code(&r4300->cached_interp, alt_addr>>12))
         {
             cached_interp_init_block(r4300, alt_addr);
         }
@@ -820,10 +1469,11 @@ void cached_interp_init_block(struct r4300_core* r4300, uint32_t address)
 
 void cached_interp_free_block(struct precomp_block* block)
 {
-    if (block->block) {
-        free(block->block);
-        block->block = NULL;
-    }
+    free_traces(block, NULL);
+    free_idle_loops(block);
+
+    /* the instructions are released with the arena */
+    block->block = NULL;
 }
 
 void cached_interp_recompile_block(struct r4300_core* r4300, const uint32_t* iw, struct precomp_block* block, uint32_t func)
@@ -842,6 +1492,7 @@ void cached_interp_recompile_block(struct r4300_core* r4300, const uint32_t* iw,
     /* reset xxhash */
     block->xxhash = 0;
 
+    free_traces(block, r4300->cached_interp.trace);
 
     for (i = (func & 0xFFF) / 4, finished = 0; finished != 2; ++i)
     {
@@ -853,8 +1504,9 @@ void cached_interp_recompile_block(struct r4300_core* r4300, const uint32_t* iw,
         if (block_start_in_tlb)
         {
             uint32_t address2 = virtual_to_physical_address(r4300, inst->addr, 0);
-            if (r4300->cached_interp.blocks[address2>>12]->block[(address2&UINT32_C(0xFFF))/4].ops == cached_interp_NOTCOMPILED) {
-                r4300->cached_interp.blocks[address2>>12]->block[(address2&UINT32_C(0xFFF))/4].ops = cached_interp_NOTCOMPILED2;
+            struct precomp_instr* inst2 = &cached_interp_get_block(&r4300->cached_interp, address2)->block[(address2&UINT32_C(0xFFF))/4];
+            if (inst2->ops == cached_interp_NOTCOMPILED) {
+                inst2->ops = cached_interp_NOTCOMPILED2;
             }
         }
 
@@ -876,6 +1528,9 @@ void cached_interp_recompile_block(struct r4300_core* r4300, const uint32_t* iw,
         }
     }
 
+    detect_idle_loops(r4300, block, (func & 0xFFF) / 4, i);
+    fuse_instructions(r4300, block, (func & 0xFFF) / 4, i);
+
     if (i >= length)
     {
         inst = block->block + i;
@@ -909,29 +1564,80 @@ void cached_interpreter_jump_to(struct r4300_core* r4300, uint32_t address)
     }
 
     /* setup new block if invalid */
-    if (cinterp->invalid_code[address >> 12]) {
+    if (cached_interp_invalid_code(cinterp, address >> 12)) {
         r4300->cached_interp.init_block(r4300, address);
     }
 
     /* set new PC */
-    cinterp->actual = cinterp->blocks[address >> 12];
+    cinterp->actual = cached_interp_get_block(cinterp, address);
     (*r4300_pc_struct(r4300)) = cinterp->actual->block + ((address - cinterp->actual->start) >> 2);
+
+    if (cinterp->trace_enabled && cinterp->trace == NULL) {
+        count_trace_entry(cinterp->actual, *r4300_pc_struct(r4300));
+    }
 }
 
 
-void init_blocks(struct cached_interp* cinterp)
+struct precomp_block** cached_interp_block_slot(struct cached_interp* cinterp, uint32_t address)
 {
-    size_t i;
-    for (i = 0; i < 0x100000; ++i)
+#if defined(CACHED_INTERP_BLOCKS_TWO_LEVEL)
+    struct precomp_block*** table = &cinterp->blocks[address >> 22];
+
+    if (*table == NULL)
     {
-        cinterp->invalid_code[i] = 1;
-        cinterp->blocks[i] = NULL;
+        *table = calloc(0x400, sizeof((*table)[0]));
+        if (*table == NULL)
+            return NULL;
     }
+
+    return &(*table)[(address >> 12) & 0x3ff];
+#else
+    return &cinterp->blocks[address >> 12];
+#endif
+}
+
+void init_blocks(struct cached_interp* cinterp)
+{
+    invalidate_all_code(cinterp);
+    memset(cinterp->blocks, 0, sizeof(cinterp->blocks));
+
+    cinterp->slabs = NULL;
+    cinterp->slab_free = 0;
+
+    cinterp->trace_enabled = 0;
+    cinterp->trace = NULL;
+    cinterp->fused_pairs = 0;
+#ifdef DBG
+    cinterp->fusion_hits = 0;
+#endif
+    cinterp->idle_loops = 0;
+    cinterp->idle_loop_skips = 0;
+    cinterp->idle_loop_cycles = 0;
 }
 
 void free_blocks(struct cached_interp* cinterp)
 {
     size_t i;
+#if defined(CACHED_INTERP_BLOCKS_TWO_LEVEL)
+    size_t j;
+    for (i = 0; i < 0x400; ++i)
+    {
+        struct precomp_block** table = cinterp->blocks[i];
+        if (table == NULL)
+            continue;
+
+        for (j = 0; j < 0x400; ++j)
+        {
+            if (table[j])
+            {
+                cinterp->free_block(table[j]);
+                free(table[j]);
+            }
+        }
+        free(table);
+        cinterp->blocks[i] = NULL;
+    }
+#else
     for (i = 0; i < 0x100000; ++i)
     {
         if (cinterp->blocks[i])
@@ -941,6 +1647,9 @@ void free_blocks(struct cached_interp* cinterp)
             cinterp->blocks[i] = NULL;
         }
     }
+#endif
+
+    free_block_slabs(cinterp);
 }
 
 void invalidate_cached_code_hacktarux(struct r4300_core* r4300, uint32_t address, size_t size)
@@ -952,7 +1661,7 @@ void invalidate_cached_code_hacktarux(struct r4300_core* r4300, uint32_t address
     if (size == 0)
     {
         /* invalidate everthing */
-        memset(r4300->cached_interp.invalid_code, 1, 0x100000);
+        invalidate_all_code(&r4300->cached_interp);
     }
     else
     {
@@ -963,12 +1672,13 @@ void invalidate_cached_code_hacktarux(struct r4300_core* r4300, uint32_t address
         {
             i = (addr >> 12);
 
-            if (r4300->cached_interp.invalid_code[i] == 0)
+            if (!cached_interp_invalid_code(&r4300->cached_interp, i))
             {
-                if (r4300->cached_interp.blocks[i] == NULL
-                 || r4300->cached_interp.blocks[i]->block[(addr & 0xfff) / 4].ops != r4300->cached_interp.not_compiled)
+                const struct precomp_block* block = cached_interp_get_block(&r4300->cached_interp, addr);
+                if (block == NULL
+                 || block->block[(addr & 0xfff) / 4].ops != r4300->cached_interp.not_compiled)
                 {
-                    r4300->cached_interp.invalid_code[i] = 1;
+                    cached_interp_set_invalid_code(&r4300->cached_interp, i, 1);
                     /* go directly to next i */
                     addr &= ~0xfff;
                     addr |= 0xffc;
@@ -986,6 +1696,10 @@ void invalidate_cached_code_hacktarux(struct r4300_core* r4300, uint32_t address
 
 void run_cached_interpreter(struct r4300_core* r4300)
 {
+#ifndef COMPARE_CORE
+    r4300->cached_interp.trace_enabled = 1;
+#endif
+
     while (!*r4300_stop(r4300))
     {
 #ifdef COMPARE_CORE
@@ -998,4 +1712,17 @@ void run_cached_interpreter(struct r4300_core* r4300)
 #endif
         (*r4300_pc_struct(r4300))->ops();
     }
+
+    r4300->cached_interp.trace_enabled = 0;
+
+#ifdef DBG
+    DebugMessage(M64MSG_INFO, "Cached interpreter: %u instruction pairs fused, %" PRIu64 " fused executions",
+        r4300->cached_interp.fused_pairs, r4300->cached_interp.fusion_hits);
+#else
+    DebugMessage(M64MSG_INFO, "Cached interpreter: %u instruction pairs fused",
+        r4300->cached_interp.fused_pairs);
+#endif
+    DebugMessage(M64MSG_INFO, "Cached interpreter: %u idle loops detected in '%s', %" PRIu64 " cycles skipped by %" PRIu64 " fast-forwards",
+        r4300->cached_interp.idle_loops, ROM_PARAMS.headername,
+        r4300->cached_interp.idle_loop_cycles, r4300->cached_interp.idle_loop_skips);
 }
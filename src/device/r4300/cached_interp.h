@@ -43,6 +43,10 @@ void cached_interp_free_block(struct precomp_block* block);
 
 void cached_interp_recompile_block(struct r4300_core* r4300, const uint32_t* iw, struct precomp_block* block, uint32_t func);
 
+/* Returns where the block of the given address is stored, or NULL if
+ * memory is exhausted */
+struct precomp_block** cached_interp_block_slot(struct cached_interp* cinterp, uint32_t address);
+
 void init_blocks(struct cached_interp* cinterp);
 void free_blocks(struct cached_interp* cinterp);
 
@@ -54,6 +58,8 @@ void run_cached_interpreter(struct r4300_core* r4300);
 void cached_interpreter_jump_to(struct r4300_core* r4300, uint32_t address);
 
 void cached_interp_FIN_BLOCK(void);
+void cached_interp_TRACE(void);
+void cached_interp_IDLE_LOOP(void);
 void cached_interp_NOTCOMPILED(void);
 void cached_interp_NOTCOMPILED2(void);
 void cached_interp_NI(void);
@@ -141,6 +141,7 @@ enum r4300_cp0_registers
 
 
 enum { INTERRUPT_NODES_POOL_CAPACITY = 16 };
+enum { INTERRUPT_EVENT_TYPES_COUNT = 15 }; /* one per event type bit, VI_INT to DD_DV_INT */
 
 struct interrupt_event
 {
@@ -151,7 +152,9 @@ struct interrupt_event
 struct node
 {
     struct interrupt_event data;
-    struct node *next;
+    uint64_t key;       /* count on the queue's 64-bit timeline */
+    int64_t seq;        /* order among events with the same key */
+    size_t heap_index;
 };
 
 struct pool
@@ -164,7 +167,20 @@ struct pool
 struct interrupt_queue
 {
     struct pool pool;
-    struct node* first;
+
+    /* binary min-heap of the pending events, ordered by key then seq */
+    struct node* heap[INTERRUPT_NODES_POOL_CAPACITY];
+    size_t size;
+
+    /* first pending event of each type, and how many are pending */
+    struct node* first_of_type[INTERRUPT_EVENT_TYPES_COUNT];
+    unsigned int type_count[INTERRUPT_EVENT_TYPES_COUNT];
+
+    /* the count base_count has key base_key */
+    uint32_t base_count;
+    uint64_t base_key;
+    int64_t last_seq;
+    int64_t first_seq;
 };
 
 struct interrupt_handler
@@ -24,9 +24,14 @@
 
 #include "cp0.h"
 #include "cp1.h"
+#include "fpu.h"
 
 #include "new_dynarec/new_dynarec.h"
 
+#if defined(_MSC_VER) && defined(M64P_FPU_ROUND_KERNELS) && !defined(__aarch64__)
+#include <intrin.h>
+#endif
+
 #define FCR31_FS_BIT UINT32_C(0x1000000)
 
 #ifdef M64P_BIG_ENDIAN
@@ -35,11 +40,31 @@
 #define DOUBLE_HALF_XOR 0
 #endif
 
+uint32_t g_fpu_host_rounding = FPU_HOST_ROUNDING_UNKNOWN;
+
+#if defined(M64P_FPU_ROUND_KERNELS) && !defined(__aarch64__)
+int g_fpu_sse41;
+
+static int detect_sse41(void)
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] >> 19) & 1;
+#else
+    return __builtin_cpu_supports("sse4.1") ? 1 : 0;
+#endif
+}
+#endif
+
 void init_cp1(struct cp1* cp1, struct new_dynarec_hot_state* new_dynarec_hot_state)
 {
 #ifdef NEW_DYNAREC
     cp1->new_dynarec_hot_state = new_dynarec_hot_state;
 #endif
+#if defined(M64P_FPU_ROUND_KERNELS) && !defined(__aarch64__)
+    g_fpu_sse41 = detect_sse41();
+#endif
 }
 
 void poweron_cp1(struct cp1* cp1)
@@ -126,7 +151,8 @@ void set_fpr_pointers(struct cp1* cp1, uint32_t newStatus)
 
 /* XXX: This shouldn't really be here, but rounding_mode is used by the
  * Hacktarux JIT and updated by CTC1 and saved states. Figure out a better
- * place for this. */
+ * place for this. It is also where the host rounding mode gets switched,
+ * the COP1 helpers only switch it again if FCR31 changed elsewhere. */
 void update_x86_rounding_mode(struct cp1* cp1)
 {
     uint32_t fcr31 = *r4300_cp1_fcr31(cp1);
@@ -145,6 +171,10 @@ void update_x86_rounding_mode(struct cp1* cp1)
     }
 #endif
 
+    /* The host mode may have been changed behind our back (dynarec, plugins),
+     * so apply it unconditionally here rather than through set_rounding. */
+    apply_rounding(fcr31);
+
     switch (fcr31 & 3)
     {
     case 0: /* Round to nearest, or to even if equidistant */
@@ -25,6 +25,8 @@
 #include <math.h>
 #include <stdint.h>
 
+#include "osal/preproc.h"
+
 #ifdef _MSC_VER
 #define M64P_FPU_INLINE static __inline
 #include <float.h>
@@ -67,8 +69,15 @@ static __inline float  truncf(float x) { return (float)(int)x; }
 #define FCR31_FLAG_INVALIDOP_BIT UINT32_C(0x000040)
 
 
-M64P_FPU_INLINE void set_rounding(uint32_t fcr31)
+/* Rounding mode (FCR31 & 3) currently applied to the host FPU, or
+ * FPU_HOST_ROUNDING_UNKNOWN when it has to be set again. */
+#define FPU_HOST_ROUNDING_UNKNOWN UINT32_C(0xffffffff)
+extern uint32_t g_fpu_host_rounding;
+
+M64P_FPU_INLINE void apply_rounding(uint32_t fcr31)
 {
+    g_fpu_host_rounding = fcr31 & 3;
+
     switch(fcr31 & 3) {
     case 0: /* Round to nearest, or to even if equidistant */
         fesetround(FE_TONEAREST);
@@ -85,6 +94,133 @@ M64P_FPU_INLINE void set_rounding(uint32_t fcr31)
     }
 }
 
+/* fesetround is slow on most hosts, so only call it when FCR31 asks for
+ * a different mode than the one already applied. */
+M64P_FPU_INLINE void set_rounding(uint32_t fcr31)
+{
+    if ((fcr31 & 3) != g_fpu_host_rounding)
+    {
+        apply_rounding(fcr31);
+    }
+}
+
+/* Explicit-mode rounding kernels for ROUND/TRUNC/CEIL/FLOOR.
+ * ARMv8 always has FRINT*, SSE4.1 availability is checked at runtime. */
+#if defined(__aarch64__)
+#define M64P_FPU_ROUND_KERNELS
+
+M64P_FPU_INLINE int fpu_has_round_kernels(void) { return 1; }
+
+M64P_FPU_INLINE float roundevenf_kernel(float x) { float r; __asm__("frintn %s0, %s1" : "=w"(r) : "w"(x)); return r; }
+M64P_FPU_INLINE float truncf_kernel(float x)     { float r; __asm__("frintz %s0, %s1" : "=w"(r) : "w"(x)); return r; }
+M64P_FPU_INLINE float ceilf_kernel(float x)      { float r; __asm__("frintp %s0, %s1" : "=w"(r) : "w"(x)); return r; }
+M64P_FPU_INLINE float floorf_kernel(float x)     { float r; __asm__("frintm %s0, %s1" : "=w"(r) : "w"(x)); return r; }
+
+M64P_FPU_INLINE double roundeven_kernel(double x) { double r; __asm__("frintn %d0, %d1" : "=w"(r) : "w"(x)); return r; }
+M64P_FPU_INLINE double trunc_kernel(double x)     { double r; __asm__("frintz %d0, %d1" : "=w"(r) : "w"(x)); return r; }
+M64P_FPU_INLINE double ceil_kernel(double x)      { double r; __asm__("frintp %d0, %d1" : "=w"(r) : "w"(x)); return r; }
+M64P_FPU_INLINE double floor_kernel(double x)     { double r; __asm__("frintm %d0, %d1" : "=w"(r) : "w"(x)); return r; }
+
+#elif defined(OSAL_SSE) && (defined(__GNUC__) || defined(_MSC_VER))
+#define M64P_FPU_ROUND_KERNELS
+
+#if defined(__GNUC__) && !defined(__SSE4_1__)
+#include <smmintrin.h>
+#define M64P_FPU_SSE41 __attribute__((target("sse4.1")))
+#else
+#define M64P_FPU_SSE41
+#endif
+
+/* set by init_cp1 */
+extern int g_fpu_sse41;
+
+M64P_FPU_INLINE int fpu_has_round_kernels(void)
+{
+#ifdef __SSE4_1__
+    return 1;
+#else
+    return g_fpu_sse41;
+#endif
+}
+
+#define FPU_SSE41_ROUNDF(mode) _mm_cvtss_f32(_mm_round_ss(_mm_set_ss(x), _mm_set_ss(x), (mode) | _MM_FROUND_NO_EXC))
+#define FPU_SSE41_ROUND(mode)  _mm_cvtsd_f64(_mm_round_sd(_mm_set_sd(x), _mm_set_sd(x), (mode) | _MM_FROUND_NO_EXC))
+
+M64P_FPU_SSE41 M64P_FPU_INLINE float roundevenf_kernel(float x) { return FPU_SSE41_ROUNDF(_MM_FROUND_TO_NEAREST_INT); }
+M64P_FPU_SSE41 M64P_FPU_INLINE float truncf_kernel(float x)     { return FPU_SSE41_ROUNDF(_MM_FROUND_TO_ZERO); }
+M64P_FPU_SSE41 M64P_FPU_INLINE float ceilf_kernel(float x)      { return FPU_SSE41_ROUNDF(_MM_FROUND_TO_POS_INF); }
+M64P_FPU_SSE41 M64P_FPU_INLINE float floorf_kernel(float x)     { return FPU_SSE41_ROUNDF(_MM_FROUND_TO_NEG_INF); }
+
+M64P_FPU_SSE41 M64P_FPU_INLINE double roundeven_kernel(double x) { return FPU_SSE41_ROUND(_MM_FROUND_TO_NEAREST_INT); }
+M64P_FPU_SSE41 M64P_FPU_INLINE double trunc_kernel(double x)     { return FPU_SSE41_ROUND(_MM_FROUND_TO_ZERO); }
+M64P_FPU_SSE41 M64P_FPU_INLINE double ceil_kernel(double x)      { return FPU_SSE41_ROUND(_MM_FROUND_TO_POS_INF); }
+M64P_FPU_SSE41 M64P_FPU_INLINE double floor_kernel(double x)     { return FPU_SSE41_ROUND(_MM_FROUND_TO_NEG_INF); }
+
+#undef FPU_SSE41_ROUNDF
+#undef FPU_SSE41_ROUND
+#endif
+
+M64P_FPU_INLINE float fpu_truncf(float x)
+{
+#ifdef M64P_FPU_ROUND_KERNELS
+    if (fpu_has_round_kernels())
+    {
+        return truncf_kernel(x);
+    }
+#endif
+    return truncf(x);
+}
+M64P_FPU_INLINE float fpu_ceilf(float x)
+{
+#ifdef M64P_FPU_ROUND_KERNELS
+    if (fpu_has_round_kernels())
+    {
+        return ceilf_kernel(x);
+    }
+#endif
+    return ceilf(x);
+}
+M64P_FPU_INLINE float fpu_floorf(float x)
+{
+#ifdef M64P_FPU_ROUND_KERNELS
+    if (fpu_has_round_kernels())
+    {
+        return floorf_kernel(x);
+    }
+#endif
+    return floorf(x);
+}
+M64P_FPU_INLINE double fpu_trunc(double x)
+{
+#ifdef M64P_FPU_ROUND_KERNELS
+    if (fpu_has_round_kernels())
+    {
+        return trunc_kernel(x);
+    }
+#endif
+    return trunc(x);
+}
+M64P_FPU_INLINE double fpu_ceil(double x)
+{
+#ifdef M64P_FPU_ROUND_KERNELS
+    if (fpu_has_round_kernels())
+    {
+        return ceil_kernel(x);
+    }
+#endif
+    return ceil(x);
+}
+M64P_FPU_INLINE double fpu_floor(double x)
+{
+#ifdef M64P_FPU_ROUND_KERNELS
+    if (fpu_has_round_kernels())
+    {
+        return floor_kernel(x);
+    }
+#endif
+    return floor(x);
+}
+
 #ifdef ACCURATE_FPU_BEHAVIOR
 M64P_FPU_INLINE void fpu_reset_cause(uint32_t* fcr31)
 {
@@ -302,7 +438,17 @@ M64P_FPU_INLINE void cvt_s_d(uint32_t* fcr31, const double* source, float* dest)
 
 M64P_FPU_INLINE void round_l_s(const float* source, int64_t* dest)
 {
-    float remainder = *source - floorf(*source);
+    float remainder;
+
+#ifdef M64P_FPU_ROUND_KERNELS
+    if (fpu_has_round_kernels())
+    {
+        *dest = (int64_t)roundevenf_kernel(*source);
+        return;
+    }
+#endif
+
+    remainder = *source - floorf(*source);
     if (remainder == 0.5)
     {
         if (*source < 0)
@@ -321,7 +467,17 @@ M64P_FPU_INLINE void round_l_s(const float* source, int64_t* dest)
 }
 M64P_FPU_INLINE void round_w_s(const float* source, int32_t* dest)
 {
-    float remainder = *source - floorf(*source);
+    float remainder;
+
+#ifdef M64P_FPU_ROUND_KERNELS
+    if (fpu_has_round_kernels())
+    {
+        *dest = (int32_t)roundevenf_kernel(*source);
+        return;
+    }
+#endif
+
+    remainder = *source - floorf(*source);
     if (remainder == 0.5)
     {
         if (*source < 0)
@@ -340,32 +496,42 @@ M64P_FPU_INLINE void round_w_s(const float* source, int32_t* dest)
 }
 M64P_FPU_INLINE void trunc_l_s(const float* source, int64_t* dest)
 {
-    *dest = (int64_t)truncf(*source);
+    *dest = (int64_t)fpu_truncf(*source);
 }
 M64P_FPU_INLINE void trunc_w_s(const float* source, int32_t* dest)
 {
-    *dest = (int32_t)truncf(*source);
+    *dest = (int32_t)fpu_truncf(*source);
 }
 M64P_FPU_INLINE void ceil_l_s(const float* source, int64_t* dest)
 {
-    *dest = (int64_t)ceilf(*source);
+    *dest = (int64_t)fpu_ceilf(*source);
 }
 M64P_FPU_INLINE void ceil_w_s(const float* source, int32_t* dest)
 {
-    *dest = (int32_t)ceilf(*source);
+    *dest = (int32_t)fpu_ceilf(*source);
 }
 M64P_FPU_INLINE void floor_l_s(const float* source, int64_t* dest)
 {
-    *dest = (int64_t)floorf(*source);
+    *dest = (int64_t)fpu_floorf(*source);
 }
 M64P_FPU_INLINE void floor_w_s(const float* source, int32_t* dest)
 {
-    *dest = (int32_t)floorf(*source);
+    *dest = (int32_t)fpu_floorf(*source);
 }
 
 M64P_FPU_INLINE void round_l_d(const double* source, int64_t* dest)
 {
-    double remainder = *source - floor(*source);
+    double remainder;
+
+#ifdef M64P_FPU_ROUND_KERNELS
+    if (fpu_has_round_kernels())
+    {
+        *dest = (int64_t)roundeven_kernel(*source);
+        return;
+    }
+#endif
+
+    remainder = *source - floor(*source);
     if (remainder == 0.5)
     {
         if (*source < 0)
@@ -384,7 +550,17 @@ M64P_FPU_INLINE void round_l_d(const double* source, int64_t* dest)
 }
 M64P_FPU_INLINE void round_w_d(const double* source, int32_t* dest)
 {
-    double remainder = *source - floor(*source);
+    double remainder;
+
+#ifdef M64P_FPU_ROUND_KERNELS
+    if (fpu_has_round_kernels())
+    {
+        *dest = (int32_t)roundeven_kernel(*source);
+        return;
+    }
+#endif
+
+    remainder = *source - floor(*source);
     if (remainder == 0.5)
     {
         if (*source < 0)
@@ -404,27 +580,27 @@ M64P_FPU_INLINE void round_w_d(const double* source, int32_t* dest)
 }
 M64P_FPU_INLINE void trunc_l_d(const double* source, int64_t* dest)
 {
-    *dest = (int64_t)trunc(*source);
+    *dest = (int64_t)fpu_trunc(*source);
 }
 M64P_FPU_INLINE void trunc_w_d(const double* source, int32_t* dest)
 {
-    *dest = (int32_t)trunc(*source);
+    *dest = (int32_t)fpu_trunc(*source);
 }
 M64P_FPU_INLINE void ceil_l_d(const double* source, int64_t* dest)
 {
-    *dest = (int64_t)ceil(*source);
+    *dest = (int64_t)fpu_ceil(*source);
 }
 M64P_FPU_INLINE void ceil_w_d(const double* source, int32_t* dest)
 {
-    *dest = (int32_t)ceil(*source);
+    *dest = (int32_t)fpu_ceil(*source);
 }
 M64P_FPU_INLINE void floor_l_d(const double* source, int64_t* dest)
 {
-    *dest = (int64_t)floor(*source);
+    *dest = (int64_t)fpu_floor(*source);
 }
 M64P_FPU_INLINE void floor_w_d(const double* source, int32_t* dest)
 {
-    *dest = (int32_t)floor(*source);
+    *dest = (int32_t)fpu_floor(*source);
 }
 
 M64P_FPU_INLINE void cvt_w_s(uint32_t* fcr31, const float* source, int32_t* dest)
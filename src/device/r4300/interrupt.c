@@ -48,7 +48,7 @@
 
 
 /***************************************************************************
- * Pool of Single Linked List Nodes
+ * Pool of Event Nodes
  **************************************************************************/
 
 static struct node* alloc_node(struct pool* p);
@@ -90,26 +90,168 @@ static void clear_pool(struct pool* p)
 
 /***************************************************************************
  * Interrupt Queue
+ *
+ * Pending events are kept in a binary min-heap. Their key places their count
+ * on a 64-bit timeline extended from the count they are compared from (see
+ * event_key), so that the wraparound of the count register doesn't break the
+ * order. Events due at the same count keep their insertion order.
  **************************************************************************/
 
 static void clear_queue(struct interrupt_queue* q)
 {
-    q->first = NULL;
+    q->size = 0;
+    memset(q->first_of_type, 0, sizeof(q->first_of_type));
+    memset(q->type_count, 0, sizeof(q->type_count));
+    q->base_count = 0;
+    q->base_key = UINT64_C(1) << 32;
+    q->last_seq = 0;
+    q->first_seq = 0;
     clear_pool(&q->pool);
 }
 
-static int before_event(const struct cp0* cp0, unsigned int evt1, unsigned int evt2, int type2)
+/* Returns the first_of_type index of an event type, -1 if it has none */
+static int event_type_index(int type)
 {
-    const uint32_t* cp0_regs = r4300_cp0_regs((struct cp0*)cp0); /* OK to cast away const qualifier */
+    int index;
+
+    for (index = 0; index < INTERRUPT_EVENT_TYPES_COUNT; ++index) {
+        if (type == (1 << index)) {
+            return index;
+        }
+    }
+
+    return -1;
+}
+
+/* Counts are taken as coming after the current count, or after the count
+ * of the next event if it is already due. */
+static uint64_t event_key(struct cp0* cp0, unsigned int evt)
+{
+    const uint32_t* cp0_regs = r4300_cp0_regs(cp0);
     uint32_t count = cp0_regs[CP0_COUNT_REG];
-    int* cp0_cycle_count = r4300_cp0_cycle_count((struct cp0*)cp0);
+    int* cp0_cycle_count = r4300_cp0_cycle_count(cp0);
 
     /* At least one other interrupt is pending */
     if (*cp0_cycle_count > 0)
         count -= *cp0_cycle_count;
 
-    if ((evt1 - count) < (evt2 - count)) return 1;
-    else return 0;
+    cp0->q.base_key += (int32_t)(count - cp0->q.base_count);
+    cp0->q.base_count = count;
+
+    return cp0->q.base_key + (uint32_t)(evt - count);
+}
+
+static int before_node(const struct node* e1, const struct node* e2)
+{
+    return (e1->key < e2->key)
+        || (e1->key == e2->key && e1->seq < e2->seq);
+}
+
+static void set_heap_node(struct interrupt_queue* q, size_t i, struct node* e)
+{
+    q->heap[i] = e;
+    e->heap_index = i;
+}
+
+static void sift_up(struct interrupt_queue* q, size_t i)
+{
+    struct node* e = q->heap[i];
+
+    while (i > 0)
+    {
+        size_t parent = (i - 1) / 2;
+        if (!before_node(e, q->heap[parent]))
+            break;
+
+        set_heap_node(q, i, q->heap[parent]);
+        i = parent;
+    }
+
+    set_heap_node(q, i, e);
+}
+
+static void sift_down(struct interrupt_queue* q, size_t i)
+{
+    struct node* e = q->heap[i];
+
+    for (;;)
+    {
+        size_t child = 2 * i + 1;
+        if (child >= q->size)
+            break;
+
+        if (child + 1 < q->size && before_node(q->heap[child + 1], q->heap[child]))
+            ++child;
+
+        if (!before_node(q->heap[child], e))
+            break;
+
+        set_heap_node(q, i, q->heap[child]);
+        i = child;
+    }
+
+    set_heap_node(q, i, e);
+}
+
+/* linear search, for types without index or pending more than once */
+static struct node* find_first_of_type(const struct interrupt_queue* q, int type)
+{
+    struct node* first = NULL;
+    size_t i;
+
+    for (i = 0; i < q->size; ++i)
+    {
+        struct node* e = q->heap[i];
+        if (e->data.type == type && (first == NULL || before_node(e, first)))
+            first = e;
+    }
+
+    return first;
+}
+
+static void insert_node(struct interrupt_queue* q, struct node* e)
+{
+    int index = event_type_index(e->data.type);
+
+    set_heap_node(q, q->size++, e);
+    sift_up(q, e->heap_index);
+
+    if (index >= 0)
+    {
+        ++q->type_count[index];
+        if (q->first_of_type[index] == NULL || before_node(e, q->first_of_type[index]))
+            q->first_of_type[index] = e;
+    }
+}
+
+static void remove_node(struct interrupt_queue* q, struct node* e)
+{
+    size_t i = e->heap_index;
+    int index = event_type_index(e->data.type);
+
+    if (i != --q->size)
+    {
+        struct node* last = q->heap[q->size];
+        set_heap_node(q, i, last);
+
+        if (i > 0 && before_node(last, q->heap[(i - 1) / 2]))
+            sift_up(q, i);
+        else
+            sift_down(q, i);
+    }
+
+    if (index >= 0)
+    {
+        --q->type_count[index];
+        if (q->first_of_type[index] == e)
+        {
+            q->first_of_type[index] = (q->type_count[index] != 0)
+                ? find_first_of_type(q, e->data.type)
+                : NULL;
+        }
+    }
+
+    free_node(&q->pool, e);
 }
 
 unsigned int add_random_interrupt_time(struct r4300_core* r4300)
@@ -135,7 +277,6 @@ void add_interrupt_event(struct cp0* cp0, int type, unsigned int delay)
 void add_interrupt_event_count(struct cp0* cp0, int type, unsigned int count)
 {
     struct node* event;
-    struct node* e;
     const uint32_t* cp0_regs = r4300_cp0_regs(cp0);
     unsigned int* cp0_next_interrupt = r4300_cp0_next_interrupt(cp0);
     int* cp0_cycle_count = r4300_cp0_cycle_count(cp0);
@@ -153,128 +294,81 @@ void add_interrupt_event_count(struct cp0* cp0, int type, unsigned int count)
 
     event->data.count = count;
     event->data.type = type;
+    event->key = event_key(cp0, count);
+    event->seq = ++cp0->q.last_seq;
 
-    if (cp0->q.first == NULL)
-    {
-        cp0->q.first = event;
-        event->next = NULL;
-    }
-    else if (before_event(cp0, count, cp0->q.first->data.count, cp0->q.first->data.type))
-    {
-        event->next = cp0->q.first;
-        cp0->q.first = event;
-    }
-    else
-    {
-        for (e = cp0->q.first;
-            e->next != NULL &&
-            (!before_event(cp0, count, e->next->data.count, e->next->data.type));
-            e = e->next);
+    insert_node(&cp0->q, event);
 
-        if (e->next == NULL)
-        {
-            e->next = event;
-            event->next = NULL;
-        }
-        else
-        {
-            for(; e->next != NULL && e->next->data.count == count; e = e->next);
-
-            event->next = e->next;
-            e->next = event;
-        }
-    }
-    *cp0_next_interrupt = cp0->q.first->data.count;
-    *cp0_cycle_count = cp0_regs[CP0_COUNT_REG] - cp0->q.first->data.count;
+    *cp0_next_interrupt = cp0->q.heap[0]->data.count;
+    *cp0_cycle_count = cp0_regs[CP0_COUNT_REG] - cp0->q.heap[0]->data.count;
 }
 
 void remove_interrupt_event(struct cp0* cp0)
 {
-    struct node* e;
     const uint32_t* cp0_regs = r4300_cp0_regs(cp0);
     unsigned int* cp0_next_interrupt = r4300_cp0_next_interrupt(cp0);
     int* cp0_cycle_count = r4300_cp0_cycle_count(cp0);
 
-    e = cp0->q.first;
-    cp0->q.first = e->next;
-    free_node(&cp0->q.pool, e);
+    remove_node(&cp0->q, cp0->q.heap[0]);
 
-    *cp0_next_interrupt = (cp0->q.first != NULL)
-        ? cp0->q.first->data.count
+    *cp0_next_interrupt = (cp0->q.size != 0)
+        ? cp0->q.heap[0]->data.count
         : 0;
 
-    *cp0_cycle_count = (cp0->q.first != NULL)
-        ? (cp0_regs[CP0_COUNT_REG] - cp0->q.first->data.count)
+    *cp0_cycle_count = (cp0->q.size != 0)
+        ? (cp0_regs[CP0_COUNT_REG] - cp0->q.heap[0]->data.count)
         : 0;
 }
 
 unsigned int* get_event(const struct interrupt_queue* q, int type)
 {
-    struct node* e = q->first;
-
-    if (e == NULL) {
-        return NULL;
-    }
-
-    if (e->data.type == type) {
-        return &e->data.count;
-    }
+    int index = event_type_index(type);
+    struct node* e = (index >= 0)
+        ? q->first_of_type[index]
+        : find_first_of_type(q, type);
 
-    for (; e->next != NULL && e->next->data.type != type; e = e->next);
-
-    return (e->next != NULL)
-        ? &e->next->data.count
+    return (e != NULL)
+        ? &e->data.count
         : NULL;
 }
 
 int get_next_event_type(const struct interrupt_queue* q)
 {
-    return (q->first == NULL)
+    return (q->size == 0)
         ? 0
-        : q->first->data.type;
+        : q->heap[0]->data.type;
 }
 
 void remove_event(struct interrupt_queue* q, int type)
 {
-    struct node* to_del;
-    struct node* e = q->first;
+    int index = event_type_index(type);
+    struct node* e = (index >= 0)
+        ? q->first_of_type[index]
+        : find_first_of_type(q, type);
 
-    if (e == NULL) {
-        return;
-    }
-
-    if (e->data.type == type)
-    {
-        q->first = e->next;
-        free_node(&q->pool, e);
-    }
-    else
-    {
-        for (; e->next != NULL && e->next->data.type != type; e = e->next);
-
-        if (e->next != NULL)
-        {
-            to_del = e->next;
-            e->next = to_del->next;
-            free_node(&q->pool, to_del);
-        }
+    if (e != NULL) {
+        remove_node(q, e);
     }
 }
 
 void translate_event_queue(struct cp0* cp0, unsigned int base)
 {
-    struct node* e;
+    size_t i;
     uint32_t* cp0_regs = r4300_cp0_regs(cp0);
     int* cp0_cycle_count = r4300_cp0_cycle_count(cp0);
 
     remove_event(&cp0->q, COMPARE_INT);
     remove_event(&cp0->q, SPECIAL_INT);
 
-    for (e = cp0->q.first; e != NULL; e = e->next)
+    for (i = 0; i < cp0->q.size; ++i)
     {
+        struct node* e = cp0->q.heap[i];
         e->data.count = (e->data.count - cp0_regs[CP0_COUNT_REG]) + base;
     }
 
+    /* the timeline moves along with the events, keys are unchanged */
+    cp0->q.base_count = (cp0->q.base_count - cp0_regs[CP0_COUNT_REG]) + base;
+
     cp0_regs[CP0_COUNT_REG] = base;
     add_interrupt_event_count(cp0, SPECIAL_INT, ((cp0_regs[CP0_COUNT_REG] & UINT32_C(0x80000000)) ^ UINT32_C(0x80000000)));
 
@@ -285,20 +379,31 @@ void translate_event_queue(struct cp0* cp0, unsigned int base)
     cp0_regs[CP0_COUNT_REG] -= cp0->count_per_op;
 
     /* Update next interrupt in case first event is COMPARE_INT */
-    *cp0_cycle_count = cp0_regs[CP0_COUNT_REG] - cp0->q.first->data.count;
+    *cp0_cycle_count = cp0_regs[CP0_COUNT_REG] - cp0->q.heap[0]->data.count;
 }
 
 int save_eventqueue_infos(const struct cp0* cp0, char *buf)
 {
     int len;
-    struct node* e;
+    size_t i, j;
+    struct node* events[INTERRUPT_NODES_POOL_CAPACITY];
+
+    /* events are saved in queue order */
+    for (i = 0; i < cp0->q.size; ++i)
+    {
+        struct node* e = cp0->q.heap[i];
+        for (j = i; j > 0 && before_node(e, events[j - 1]); --j) {
+            events[j] = events[j - 1];
+        }
+        events[j] = e;
+    }
 
     len = 0;
 
-    for (e = cp0->q.first; e != NULL; e = e->next)
+    for (i = 0; i < cp0->q.size; ++i)
     {
-        memcpy(buf + len    , &e->data.type , 4);
-        memcpy(buf + len + 4, &e->data.count, 4);
+        memcpy(buf + len    , &events[i]->data.type , 4);
+        memcpy(buf + len + 4, &events[i]->data.count, 4);
         len += 8;
     }
 
@@ -361,19 +466,16 @@ void r4300_check_interrupt(struct r4300_core* r4300, uint32_t cause_ip, int set_
 
         event->data.count = *cp0_next_interrupt = cp0_regs[CP0_COUNT_REG];
         event->data.type = CHECK_INT;
-        *cp0_cycle_count = 0;
 
-        if (r4300->cp0.q.first == NULL)
-        {
-            r4300->cp0.q.first = event;
-            event->next = NULL;
+        /* goes first, even before an event which is already due */
+        event->key = event_key(&r4300->cp0, event->data.count);
+        if (r4300->cp0.q.size != 0 && r4300->cp0.q.heap[0]->key < event->key) {
+            event->key = r4300->cp0.q.heap[0]->key;
         }
-        else
-        {
-            event->next = r4300->cp0.q.first;
-            r4300->cp0.q.first = event;
+        event->seq = --r4300->cp0.q.first_seq;
+        *cp0_cycle_count = 0;
 
-        }
+        insert_node(&r4300->cp0.q, event);
     }
 }
 
@@ -406,7 +508,7 @@ void compare_int_handler(void* opaque)
     cp0_regs[CP0_COUNT_REG] -= r4300->cp0.count_per_op;
 
     /* Update next interrupt in case first event is COMPARE_INT */
-    *cp0_cycle_count = cp0_regs[CP0_COUNT_REG] - r4300->cp0.q.first->data.count;
+    *cp0_cycle_count = cp0_regs[CP0_COUNT_REG] - r4300->cp0.q.heap[0]->data.count;
 
     raise_maskable_interrupt(r4300, CP0_CAUSE_IP7);
 }
@@ -568,12 +670,12 @@ void gen_interrupt(struct r4300_core* r4300)
         uint32_t dest = r4300->skip_jump;
         r4300->skip_jump = 0;
 
-        *cp0_next_interrupt = (r4300->cp0.q.first != NULL)
-            ? r4300->cp0.q.first->data.count
+        *cp0_next_interrupt = (r4300->cp0.q.size != 0)
+            ? r4300->cp0.q.heap[0]->data.count
             : 0;
 
-        *cp0_cycle_count = (r4300->cp0.q.first != NULL)
-            ? (cp0_regs[CP0_COUNT_REG] - r4300->cp0.q.first->data.count)
+        *cp0_cycle_count = (r4300->cp0.q.size != 0)
+            ? (cp0_regs[CP0_COUNT_REG] - r4300->cp0.q.heap[0]->data.count)
             : 0;
 
         r4300->cp0.last_addr = dest;
@@ -581,7 +683,7 @@ void gen_interrupt(struct r4300_core* r4300)
         return;
     }
 
-    switch (r4300->cp0.q.first->data.type)
+    switch (r4300->cp0.q.heap[0]->data.type)
     {
         case VI_INT:
             call_interrupt_handler(&r4300->cp0, 0);
@@ -657,7 +759,7 @@ void gen_interrupt(struct r4300_core* r4300)
             break;
 
         default:
-            DebugMessage(M64MSG_ERROR, "Unknown interrupt queue event type %.8X.", r4300->cp0.q.first->data.type);
+            DebugMessage(M64MSG_ERROR, "Unknown interrupt queue event type %.8X.", r4300->cp0.q.heap[0]->data.type);
             remove_interrupt_event(&r4300->cp0);
             exception_general(r4300);
             break;
@@ -60,7 +60,7 @@ void breakpoint(void);
 static void invalidate_addr(u_int addr);
 
 static u_int literals[1024][2];
-static unsigned int needs_clear_cache[1<<(TARGET_SIZE_2-17)];
+static unsigned int needs_clear_cache[1<<(TARGET_SIZE_2_MAX-17)];
 
 static const u_int jump_vaddr_reg[16] = {
   (int)jump_vaddr_r0,
@@ -938,7 +938,7 @@ static u_int genjmp(u_int addr)
     {
       if(addr==jump_table_symbols[n])
       {
-        offset=(int)base_addr+(1<<TARGET_SIZE_2)-JUMP_TABLE_SIZE+n*8-(int)out-8;
+        offset=(int)base_addr+(1<<target_size_2)-JUMP_TABLE_SIZE+n*8-(int)out-8;
         break;
       }
     }
@@ -3940,7 +3940,7 @@ static void do_miniht_insert(u_int return_address,int rt,int temp) {
 static void do_clear_cache(void)
 {
   int i,j;
-  for (i=0;i<(1<<(TARGET_SIZE_2-17));i++)
+  for (i=0;i<(1<<(target_size_2-17));i++)
   {
     u_int bitmap=needs_clear_cache[i];
     if(bitmap) {
@@ -4001,7 +4001,7 @@ static void arch_init(void) {
   // Trampolines for jumps >32M
   int *ptr,*ptr2;
   ptr=(int *)jump_table_symbols;
-  ptr2=(int *)((char *)base_addr+(1<<TARGET_SIZE_2)-JUMP_TABLE_SIZE);
+  ptr2=(int *)((char *)base_addr+(1<<target_size_2)-JUMP_TABLE_SIZE);
   while((char *)ptr<(char *)jump_table_symbols+sizeof(jump_table_symbols))
   {
     int offset=*ptr-(int)ptr2-8;
@@ -4020,9 +4020,9 @@ static void arch_init(void) {
   // If part of the cache is beyond the 32M limit, avoid using this area
   // initially.  It will be used later if the cache gets full.
   /*if((u_int)dyna_linker-33554432>(u_int)base_addr) {
-    if((u_int)dyna_linker-33554432<(u_int)base_addr+(1<<(TARGET_SIZE_2-1))) {
+    if((u_int)dyna_linker-33554432<(u_int)base_addr+(1<<(target_size_2-1))) {
       out=(u_char *)(((u_int)dyna_linker-33554432)&~4095);
-      expirep=((((int)out-(int)base_addr)>>(TARGET_SIZE_2-16))+16384)&65535;
+      expirep=((((int)out-(int)base_addr)>>(target_size_2-16))+16384)&65535;
     }
   }*/
 }
@@ -39,7 +39,7 @@
 // Note: FP is set to &dynarec_local when executing generated code.
 // Thus the local variables are actually global and not on the stack.
 
-#define TARGET_SIZE_2 25 // 2^25 = 32 megabytes
+#define TARGET_SIZE_2_MAX 25 // Largest code cache: 2^25 = 32 megabytes
 #define JUMP_TABLE_SIZE (sizeof(jump_table_symbols)*2)
 
 #endif /* M64P_DEVICE_R4300_NEW_DYNAREC_ARM_ASSEM_ARM_H */
@@ -81,7 +81,7 @@ void breakpoint(void);
 static void invalidate_addr(u_int addr);
 
 static uintptr_t literals[1024][2];
-static unsigned int needs_clear_cache[1<<(TARGET_SIZE_2-17)];
+static unsigned int needs_clear_cache[1<<(TARGET_SIZE_2_MAX-17)];
 
 static const uintptr_t jump_vaddr_reg[32] = {
   (intptr_t)jump_vaddr_x0,
@@ -942,7 +942,7 @@ static u_int genjmp(intptr_t addr)
   if(addr<4) return 0;
   intptr_t out_rx=(intptr_t)out;
 
-  if(addr<(intptr_t)base_addr||addr>=(intptr_t)base_addr+(1<<TARGET_SIZE_2))
+  if(addr<(intptr_t)base_addr||addr>=(intptr_t)base_addr+(1<<target_size_2))
     out_rx=((intptr_t)out-(intptr_t)base_addr)+(intptr_t)base_addr_rx;
 
   intptr_t offset=addr-out_rx;
@@ -953,7 +953,7 @@ static u_int genjmp(intptr_t addr)
     {
       if(addr==jump_table_symbols[n])
       {
-        offset=(intptr_t)base_addr_rx+(1<<TARGET_SIZE_2)-JUMP_TABLE_SIZE+n*16-out_rx;
+        offset=(intptr_t)base_addr_rx+(1<<target_size_2)-JUMP_TABLE_SIZE+n*16-out_rx;
         break;
       }
     }
@@ -967,7 +967,7 @@ static u_int gencondjmp(intptr_t addr)
   if(addr<4) return 0;
   intptr_t out_rx=(intptr_t)out;
 
-  if(addr<(intptr_t)base_addr||addr>=(intptr_t)base_addr+(1<<TARGET_SIZE_2))
+  if(addr<(intptr_t)base_addr||addr>=(intptr_t)base_addr+(1<<target_size_2))
     out_rx=((intptr_t)out-(intptr_t)base_addr)+(intptr_t)base_addr_rx;
 
   intptr_t offset=addr-out_rx;
@@ -2989,7 +2989,7 @@ static void emit_breakpoint(u_int imm)
 static void emit_adr(intptr_t addr, int rt)
 {
   intptr_t out_rx=(intptr_t)out;
-  if(addr<(intptr_t)base_addr||addr>=(intptr_t)base_addr+(1<<TARGET_SIZE_2))
+  if(addr<(intptr_t)base_addr||addr>=(intptr_t)base_addr+(1<<target_size_2))
     out_rx=((intptr_t)out-(intptr_t)base_addr)+(intptr_t)base_addr_rx;
 
   intptr_t offset=addr-(intptr_t)out_rx;
@@ -3000,7 +3000,7 @@ static void emit_adr(intptr_t addr, int rt)
 static void emit_adrp(intptr_t addr, int rt)
 {
   intptr_t out_rx=(intptr_t)out;
-  if(addr<(intptr_t)base_addr||addr>=(intptr_t)base_addr+(1<<TARGET_SIZE_2))
+  if(addr<(intptr_t)base_addr||addr>=(intptr_t)base_addr+(1<<target_size_2))
     out_rx=((intptr_t)out-(intptr_t)base_addr)+(intptr_t)base_addr_rx;
 
   intptr_t offset=((addr&~0xfffLL)-((intptr_t)out_rx&~0xfffLL));
@@ -3014,7 +3014,7 @@ static void emit_adrp(intptr_t addr, int rt)
 static void emit_pc_relative_addr(intptr_t addr, int rt)
 {
   intptr_t out_rx=(intptr_t)out;
-  if(addr<(intptr_t)base_addr||addr>=(intptr_t)base_addr+(1<<TARGET_SIZE_2))
+  if(addr<(intptr_t)base_addr||addr>=(intptr_t)base_addr+(1<<target_size_2))
     out_rx=((intptr_t)out-(intptr_t)base_addr)+(intptr_t)base_addr_rx;
 
   intptr_t offset=addr-(intptr_t)out_rx;
@@ -4581,7 +4581,7 @@ static void do_miniht_insert(u_int return_address,int rt,int temp) {
 static void do_clear_cache(void)
 {
   int i,j;
-  for (i=0;i<(1<<(TARGET_SIZE_2-17));i++)
+  for (i=0;i<(1<<(target_size_2-17));i++)
   {
     u_int bitmap=needs_clear_cache[i];
     if(bitmap) {
@@ -4640,8 +4640,8 @@ static void arch_init(void) {
   // Trampolines for jumps >128MB
   intptr_t *ptr,*ptr2,*ptr3;
   ptr=(intptr_t *)jump_table_symbols;
-  ptr2=(intptr_t *)((char *)base_addr+(1<<TARGET_SIZE_2)-JUMP_TABLE_SIZE);
-  ptr3=(intptr_t *)((char *)base_addr_rx+(1<<TARGET_SIZE_2)-JUMP_TABLE_SIZE);
+  ptr2=(intptr_t *)((char *)base_addr+(1<<target_size_2)-JUMP_TABLE_SIZE);
+  ptr3=(intptr_t *)((char *)base_addr_rx+(1<<target_size_2)-JUMP_TABLE_SIZE);
   while((char *)ptr<(char *)jump_table_symbols+sizeof(jump_table_symbols))
   {
     int *ptr4=(int*)ptr2;
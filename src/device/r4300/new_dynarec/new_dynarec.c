@@ -24,6 +24,7 @@
 #include <string.h>
 #include <sys/types.h> // needed for u_int, u_char, etc
 #include <assert.h>
+#include <time.h>
 
 #if defined(WIN32)
 #ifndef WIN32_LEAN_AND_MEAN
@@ -44,11 +45,13 @@
 #include "api/callbacks.h"
 #include "main/main.h"
 #include "main/rom.h"
+#include "main/util.h"
 #include "device/memory/memory.h"
 #include "device/r4300/cached_interp.h"
 #include "device/r4300/cp0.h"
 #include "device/r4300/cp1.h"
 #include "device/r4300/interrupt.h"
+#include "device/r4300/perf_map.h"
 #include "device/r4300/tlb.h"
 #include "device/r4300/fpu.h"
 #include "device/rcp/mi/mi_controller.h"
@@ -58,6 +61,9 @@
 #include <sys/mman.h>
 #endif
 
+#define XXH_INLINE_ALL
+#include <xxhash.h>
+
 #if defined(RECOMPILER_DEBUG) && !defined(RECOMP_DBG)
 void recomp_dbg_init(void);
 void recomp_dbg_cleanup(void);
@@ -77,54 +83,98 @@ void recomp_dbg_block(int addr);
 #error Unsupported dynarec architecture
 #endif
 
-#if ((1u << TARGET_SIZE_2) != NEW_DYNAREC_CACHE_SIZE)
-#error "NEW_DYNAREC_CACHE_SIZE must match TARGET_SIZE_2"
+#define TARGET_SIZE_2_MIN 22 // Smallest code cache: 2^22 = 4 megabytes
+
+#if NEW_DYNAREC == NEW_DYNAREC_X64
+#define CACHE_REACH_2 30 // rel32 is +/-2GB, leave room for the distance from g_dev to the linkage code
+#elif NEW_DYNAREC == NEW_DYNAREC_ARM
+#define CACHE_REACH_2 25 // b/bl range, farther linkage calls go through the jump table
+#elif NEW_DYNAREC == NEW_DYNAREC_ARM64
+#define CACHE_REACH_2 27 // b/bl range, farther linkage calls go through the jump table
+#else
+#define CACHE_REACH_2 0 // 32-bit x86 reaches the whole address space
 #endif
+#define CACHE_HINT_STEP ((uintptr_t)1<<24)
 
-static size_t dynarec_host_page_size(void)
+static void* map_cache(void* addr, size_t size)
 {
 #if defined(WIN32)
-  SYSTEM_INFO sys_info;
-  GetSystemInfo(&sys_info);
-  size_t page_size = (size_t) sys_info.dwPageSize;
+  return VirtualAlloc(addr, size, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
 #else
-  long result = sysconf(_SC_PAGESIZE);
-  size_t page_size = result > 0 ? (size_t) result : 0;
+  void* p=mmap(addr, size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  return p==MAP_FAILED?NULL:p;
 #endif
-  return page_size != 0 ? page_size : 4096u;
 }
 
-static void* dynarec_align_cache_buffer(void* buffer, size_t buffer_size)
+static void free_cache(void* addr, size_t size)
 {
-  const size_t cache_size = (size_t) NEW_DYNAREC_CACHE_SIZE;
-  const size_t page_size = dynarec_host_page_size();
-  const uintptr_t base = (uintptr_t) buffer;
-  const uintptr_t end = base + buffer_size;
-  uintptr_t aligned = ((base + page_size - 1) / page_size) * page_size;
+#if defined(WIN32)
+  VirtualFree(addr, 0, MEM_RELEASE);
+#else
+  if(munmap(addr, size) < 0) DebugMessage(M64MSG_ERROR, "munmap() failed");
+#endif
+}
 
-  if (aligned + cache_size > end) {
-    const uintptr_t max_start = end - cache_size;
-    const uintptr_t fallback = (max_start / page_size) * page_size;
-    if (fallback < base) {
-      DebugMessage(M64MSG_ERROR,
-          "Unable to align dynarec cache to host page size (%zu). "
-          "Execution may fail.", page_size);
-      return (void*) base;
+static int cache_in_reach(uintptr_t addr, size_t size)
+{
+#if CACHE_REACH_2
+  uintptr_t anchor=(uintptr_t)&g_dev;
+  uintptr_t lo=addr<anchor?addr:anchor;
+  uintptr_t hi=addr+size>anchor?addr+size:anchor;
+  return hi-lo<((uintptr_t)1<<CACHE_REACH_2);
+#else
+  return 1;
+#endif
+}
+
+/* Generated code reaches the linkage code and g_dev with relative branches and addressing,
+ * so the cache is mapped as close as possible to the core image: hint addresses are tried
+ * stepping away from g_dev until one lands within reach. */
+static void* alloc_cache(size_t size)
+{
+  void* p;
+#if CACHE_REACH_2
+  const uintptr_t anchor=(uintptr_t)&g_dev&~(CACHE_HINT_STEP-1);
+  uintptr_t d;
+  for(d=CACHE_HINT_STEP;d<((uintptr_t)1<<CACHE_REACH_2);d+=CACHE_HINT_STEP) {
+    uintptr_t hint[2]={anchor+d,anchor-d-size};
+    int valid[2]={anchor+d+size>anchor+d,anchor>=d+size};
+    int i;
+    for(i=0;i<2;i++) {
+      if(!valid[i]) continue;
+      p=map_cache((void*)hint[i],size);
+      if(p==NULL) continue;
+      if(cache_in_reach((uintptr_t)p,size)) return p;
+      free_cache(p,size);
     }
-    aligned = fallback;
   }
-
-  return (void*) aligned;
+#endif
+  p=map_cache(NULL,size);
+#if NEW_DYNAREC == NEW_DYNAREC_X64
+  // No jump table on x86_64, code outside of rel32 range can't be linked
+  if(p!=NULL&&!cache_in_reach((uintptr_t)p,size)) {
+    free_cache(p,size);
+    p=NULL;
+  }
+#endif
+  return p;
 }
 
-static void ensure_dynarec_cache_alignment(void)
+static uint64_t dynarec_time_ns(void)
 {
-  if (g_dev.r4300.extra_memory != NULL)
-    return;
-
-  g_dev.r4300.extra_memory = (unsigned char*)
-      dynarec_align_cache_buffer(g_dev.r4300.extra_memory_buffer,
-                                 sizeof(g_dev.r4300.extra_memory_buffer));
+#if defined(WIN32)
+  static LARGE_INTEGER freq;
+  LARGE_INTEGER counter;
+  if (freq.QuadPart == 0)
+    QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&counter);
+  return (uint64_t)(counter.QuadPart / freq.QuadPart) * 1000000000 +
+         (uint64_t)(counter.QuadPart % freq.QuadPart) * 1000000000 / freq.QuadPart;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
 }
 
 /* debug */
@@ -274,6 +324,40 @@ struct ll_entry
   u_int length;
 };
 
+// Open addressing index of jump_in/jump_dirty by virtual address.
+// The per-page lists are kept for bulk invalidation and expiry.
+#define LL_INDEX_MIN_BITS 14
+
+struct ll_index_slot
+{
+  struct ll_entry *entry; // NULL if the slot is free
+  u_int vaddr;
+  u_int page;             // List the entry belongs to
+};
+
+struct ll_index
+{
+  struct ll_index_slot *slots;
+  u_int bits;             // log2 of the number of slots
+  u_int count;
+};
+
+#ifdef USE_JUMP_IC
+#define JUMP_IC_SIZE 1024 // Must be a power of two
+#define JUMP_IC_WAYS 2
+
+// Recent targets of an indirect jump, most recent first
+struct jump_ic
+{
+  struct
+  {
+    u_int vaddr;
+    void *addr;
+    u_int page;           // jump_in page of the target, see code_page
+  } way[JUMP_IC_WAYS];
+};
+#endif
+
 /* linkage */
 void verify_code(void);
 void cc_interrupt(void);
@@ -286,8 +370,15 @@ void dyna_linker_ds(void);
 void breakpoint(void);
 
 int new_recompile_block(int addr);
-void invalidate_block(u_int block);
+static void invalidate_code_page(u_int block);
+static u_int code_page(u_int block);
+static void invalidate_code_page(u_int block);
 void *get_addr_ht(u_int vaddr);
+#ifdef USE_JUMP_IC
+static void *get_addr_ic(u_int vaddr,struct jump_ic *ic);
+static void clear_jump_ic(void);
+static void clear_jump_ic_pages(u_int first,u_int last);
+#endif
 void *get_addr_32(u_int vaddr,u_int flags);
 
 static void load_regs_entry(int t);
@@ -350,13 +441,23 @@ static int is_delayslot;
 static int cop1_usable;
 static char *copy;
 static int expirep;
+static u_int target_size_2;       // log2 of the code cache size in use
+static u_int target_size_2_limit; // log2 of the size the code cache may grow to
+static m64p_dbg_dynarec_stats stats;
 static u_int dirty_entry_count;
 static u_int copy_size;
 static struct ll_entry* hash_table[65536][2];
 static struct ll_entry *jump_in[4096];
 static struct ll_entry *jump_dirty[4096];
 static struct ll_entry *jump_out[4096];
+static struct ll_index jump_in_index;
+static struct ll_index jump_dirty_index;
 static unsigned char restore_candidate[512];
+#ifdef USE_JUMP_IC
+static struct jump_ic jump_ic[JUMP_IC_SIZE]; // Inline caches for JR/JALR, one per jump site
+static u_int jump_ic_next;
+static u_int jump_ic_pages[4096/32]; // jump_in pages targeted by some inline cache entry
+#endif
 
 #if COUNT_NOTCOMPILEDS
 static int notcompiledCount = 0;
@@ -1970,7 +2071,8 @@ static void TLBWI_new(int pcaddr, int count)
   {
     if(i<0x80000||i>0xBFFFF)
     {
-      invalidate_block(i);
+      stats.invalidations_tlb++;
+      invalidate_code_page(i);
       state->memory_map[i]=(uintptr_t)-1;
     }
   }
@@ -1978,7 +2080,8 @@ static void TLBWI_new(int pcaddr, int count)
   {
     if(i<0x80000||i>0xBFFFF)
     {
-      invalidate_block(i);
+      stats.invalidations_tlb++;
+      invalidate_code_page(i);
       state->memory_map[i]=(uintptr_t)-1;
     }
   }
@@ -2049,7 +2152,8 @@ static void TLBWR_new(int pcaddr, int count)
   {
     if(i<0x80000||i>0xBFFFF)
     {
-      invalidate_block(i);
+      stats.invalidations_tlb++;
+      invalidate_code_page(i);
       state->memory_map[i]=(uintptr_t)-1;
     }
   }
@@ -2057,7 +2161,8 @@ static void TLBWR_new(int pcaddr, int count)
   {
     if(i<0x80000||i>0xBFFFF)
     {
-      invalidate_block(i);
+      stats.invalidations_tlb++;
+      invalidate_code_page(i);
       state->memory_map[i]=(uintptr_t)-1;
     }
   }
@@ -2411,22 +2516,148 @@ u_int verify_dirty(struct ll_entry * head)
     unsigned int page=head->start>>12;
     uintptr_t map_value=g_dev.r4300.new_dynarec_hot_state.memory_map[page];
 
-    if((intptr_t)map_value<(intptr_t)0)
+    if((intptr_t)map_value<(intptr_t)0) {
+      stats.verify_dirty_misses++;
       return head->vaddr;
+    }
 
     while(page<((head->start+head->length-1)>>12)) {
-      if((g_dev.r4300.new_dynarec_hot_state.memory_map[++page]<<2)!=(map_value<<2))
+      if((g_dev.r4300.new_dynarec_hot_state.memory_map[++page]<<2)!=(map_value<<2)) {
+        stats.verify_dirty_misses++;
         return head->vaddr;
+      }
     }
     source=(void*)(head->start+(map_value<<2));
   }
   else
     assert(0);
 
-  if(memcmp(source,head->copy,head->length))
+  if(memcmp(source,head->copy,head->length)) {
+    stats.verify_dirty_misses++;
     return head->vaddr;
-  else
-    return 0;
+  }
+  stats.verify_dirty_hits++;
+  return 0;
+}
+
+static void ll_index_init(struct ll_index *index,u_int bits)
+{
+  index->slots=(struct ll_index_slot *)calloc((size_t)1<<bits,sizeof(struct ll_index_slot));
+  assert(index->slots!=NULL);
+  index->bits=bits;
+  index->count=0;
+}
+
+static void ll_index_free(struct ll_index *index)
+{
+  free(index->slots);
+  index->slots=NULL;
+  index->bits=0;
+  index->count=0;
+}
+
+static u_int ll_index_hash(const struct ll_index *index,u_int vaddr)
+{
+  return ((vaddr>>2)*0x9E3779B1u)>>(32-index->bits);
+}
+
+// Put the slot in the first free position of its probe sequence
+static void ll_index_place(struct ll_index *index,const struct ll_index_slot *slot)
+{
+  u_int mask=(1u<<index->bits)-1;
+  u_int i=ll_index_hash(index,slot->vaddr);
+  while(index->slots[i].entry!=NULL) i=(i+1)&mask;
+  index->slots[i]=*slot;
+  index->count++;
+}
+
+static void ll_index_grow(struct ll_index *index)
+{
+  struct ll_index old=*index;
+  u_int mask=(1u<<old.bits)-1;
+  u_int first,i;
+  ll_index_init(index,old.bits+1);
+  // Start after a free slot so that every probe sequence is copied in
+  // order, which keeps the most recent entry for an address first
+  for(first=0;old.slots[first].entry!=NULL;first++);
+  for(i=(first+1)&mask;i!=first;i=(i+1)&mask)
+    if(old.slots[i].entry!=NULL) ll_index_place(index,&old.slots[i]);
+  free(old.slots);
+}
+
+static void ll_index_insert(struct ll_index *index,struct ll_entry *entry,u_int page)
+{
+  struct ll_index_slot slot,tmp;
+  u_int mask,i;
+  if((index->count+1)*2>(1u<<index->bits)) ll_index_grow(index);
+  mask=(1u<<index->bits)-1;
+  slot.entry=entry;
+  slot.vaddr=entry->vaddr;
+  slot.page=page;
+  // Entries for the same address share a probe sequence.  Rotate them so
+  // that the new one is found first, like at the head of a linked list.
+  for(i=ll_index_hash(index,slot.vaddr);index->slots[i].entry!=NULL;i=(i+1)&mask) {
+    if(index->slots[i].vaddr==slot.vaddr) {
+      tmp=index->slots[i];
+      index->slots[i]=slot;
+      slot=tmp;
+    }
+  }
+  index->slots[i]=slot;
+  index->count++;
+}
+
+static void ll_index_remove(struct ll_index *index,struct ll_entry *entry)
+{
+  u_int mask=(1u<<index->bits)-1;
+  u_int i=ll_index_hash(index,entry->vaddr);
+  u_int j,k;
+  while(index->slots[i].entry!=entry) {
+    assert(index->slots[i].entry!=NULL);
+    i=(i+1)&mask;
+  }
+  // Move back any following entry whose probe sequence crosses the hole
+  for(j=(i+1)&mask;index->slots[j].entry!=NULL;j=(j+1)&mask) {
+    k=ll_index_hash(index,index->slots[j].vaddr);
+    if(((j-k)&mask)>=((j-i)&mask)) {
+      index->slots[i]=index->slots[j];
+      i=j;
+    }
+  }
+  index->slots[i].entry=NULL;
+  index->count--;
+}
+
+// Return the next entry for vaddr in the given list, most recent first.
+// *n holds the position to resume from, ~0 to start a new search.
+static struct ll_entry *ll_index_get(const struct ll_index *index,u_int vaddr,u_int page,u_int flags,u_int *n)
+{
+  u_int mask=(1u<<index->bits)-1;
+  u_int i=(*n==~0u)?ll_index_hash(index,vaddr):*n;
+  const struct ll_index_slot *slot;
+  while((slot=&index->slots[i])->entry!=NULL) {
+    i=(i+1)&mask;
+    if(slot->vaddr==vaddr&&slot->page==page&&(slot->entry->reg32&flags)==0) {
+      *n=i;
+      return slot->entry;
+    }
+  }
+  *n=i;
+  return NULL;
+}
+
+// The index for the list at head, jump_out is not indexed
+static struct ll_index *ll_index_for(struct ll_entry **head,u_int *page)
+{
+  if(head>=jump_in&&head<jump_in+4096) {
+    *page=head-jump_in;
+    return &jump_in_index;
+  }
+  if(head>=jump_dirty&&head<jump_dirty+4096) {
+    *page=head-jump_dirty;
+    return &jump_dirty_index;
+  }
+  return NULL;
 }
 
 // Add virtual address mapping for 32-bit compiled block
@@ -2444,6 +2675,9 @@ static struct ll_entry *ll_add_32(struct ll_entry **head,int vaddr,u_int reg32,v
   new_entry->length=length;
   new_entry->next=*head;
   *head=new_entry;
+  u_int page;
+  struct ll_index *index=ll_index_for(head,&page);
+  if(index!=NULL) ll_index_insert(index,new_entry,page);
   return new_entry;
 }
 
@@ -2453,10 +2687,13 @@ static struct ll_entry *ll_add(struct ll_entry **head,int vaddr,void *addr,void
   return ll_add_32(head,vaddr,0,addr,clean_addr,start,copy,length);
 }
 
-static void ll_remove_matching_addrs(struct ll_entry **head,intptr_t addr,int shift)
+static int ll_remove_matching_addrs(struct ll_entry **head,intptr_t addr,int shift)
 {
   struct ll_entry **cur=head;
   struct ll_entry *next;
+  int removed=0;
+  u_int page;
+  struct ll_index *index=ll_index_for(head,&page);
   while(*cur) {
     if((((uintptr_t)((*cur)->addr)-(uintptr_t)base_addr)>>shift)==((addr-(uintptr_t)base_addr)>>shift) ||
        (((uintptr_t)((*cur)->addr)-(uintptr_t)base_addr-MAX_OUTPUT_BLOCK_SIZE)>>shift)==((addr-(uintptr_t)base_addr)>>shift))
@@ -2473,15 +2710,18 @@ static void ll_remove_matching_addrs(struct ll_entry **head,intptr_t addr,int sh
       }
       inv_debug("EXP: Remove pointer to %x (%x)\n",(intptr_t)(*cur)->addr,(*cur)->vaddr);
       remove_hash((*cur)->vaddr);
+      if(index!=NULL) ll_index_remove(index,*cur);
       next=(*cur)->next;
       free(*cur);
       *cur=next;
+      removed++;
     }
     else
     {
       cur=&((*cur)->next);
     }
   }
+  return removed;
 }
 
 // Remove all entries from linked list
@@ -2489,6 +2729,8 @@ static void ll_clear(struct ll_entry **head)
 {
   struct ll_entry *cur;
   struct ll_entry *next;
+  u_int page;
+  struct ll_index *index=ll_index_for(head,&page);
   if((cur=*head)) {
     *head=0;
     while(cur) {
@@ -2502,6 +2744,7 @@ static void ll_clear(struct ll_entry **head)
           copy_size-=length+4;
         }
       }
+      if(index!=NULL) ll_index_remove(index,cur);
       next=cur->next;
       free(cur);
       cur=next;
@@ -2520,6 +2763,7 @@ static void ll_kill_pointers(struct ll_entry *head,intptr_t addr,int shift)
     {
       inv_debug("EXP: Kill pointer at %x (%x)\n",(intptr_t)head->addr,head->vaddr);
       uintptr_t host_addr=(intptr_t)kill_pointer(head->addr);
+      stats.unlinks++;
       #if NEW_DYNAREC >= NEW_DYNAREC_ARM
         needs_clear_cache[(host_addr-(uintptr_t)base_addr)>>17]|=1<<(((host_addr-(uintptr_t)base_addr)>>12)&31);
       #else
@@ -2539,6 +2783,7 @@ static void add_link(u_int vaddr,void *src)
   if(page>4095) page=2048+(page&2047);
   inv_debug("add_link: %x -> %x (%d)\n",(intptr_t)src,vaddr,page);
   (void)ll_add(jump_out+page,vaddr,src,src,0,NULL,0);
+  stats.links++;
   //int ptr=get_pointer(src);
   //inv_debug("add_link: Pointer is to %x\n",(intptr_t)ptr);
 }
@@ -2548,15 +2793,8 @@ static struct ll_entry *get_clean(struct r4300_core* r4300,u_int vaddr,u_int fla
   u_int page=(vaddr^0x80000000)>>12;
   if(page>262143&&r4300->cp0.tlb.LUT_r[vaddr>>12]) page=(r4300->cp0.tlb.LUT_r[vaddr>>12]^0x80000000)>>12;
   if(page>2048) page=2048+(page&2047);
-  struct ll_entry *head;
-  head=jump_in[page];
-  while(head!=NULL) {
-    if(head->vaddr==vaddr&&(head->reg32&flags)==0) {
-      return head;
-    }
-    head=head->next;
-  }
-  return NULL;
+  u_int n=~0u;
+  return ll_index_get(&jump_in_index,vaddr,page,flags,&n);
 }
 
 static struct ll_entry *get_dirty(struct r4300_core* r4300,u_int vaddr,u_int flags)
@@ -2568,27 +2806,24 @@ static struct ll_entry *get_dirty(struct r4300_core* r4300,u_int vaddr,u_int fla
   if(vpage>262143&&r4300->cp0.tlb.LUT_r[vaddr>>12]) vpage&=2047; // jump_dirty uses a hash of the virtual address instead
   if(vpage>2048) vpage=2048+(vpage&2047);
   struct ll_entry *head;
-  head=jump_dirty[vpage];
-  while(head!=NULL) {
-    if(head->vaddr==vaddr&&(head->reg32&flags)==0) {
-      // Don't restore blocks which are about to expire from the cache
-      if((((uintptr_t)head->addr-(uintptr_t)out)<<(32-TARGET_SIZE_2))>0x60000000+(MAX_OUTPUT_BLOCK_SIZE<<(32-TARGET_SIZE_2))) {
-        if(verify_dirty(head)==0) {
-          r4300->cached_interp.invalid_code[vaddr>>12]=0;
-          r4300->new_dynarec_hot_state.memory_map[vaddr>>12]|=WRITE_PROTECT;
-          if(vpage<2048) {
-            if(r4300->cp0.tlb.LUT_r[vaddr>>12]) {
-              r4300->cached_interp.invalid_code[r4300->cp0.tlb.LUT_r[vaddr>>12]>>12]=0;
-              r4300->new_dynarec_hot_state.memory_map[r4300->cp0.tlb.LUT_r[vaddr>>12]>>12]|=WRITE_PROTECT;
-            }
-            restore_candidate[vpage>>3]|=1<<(vpage&7);
+  u_int n=~0u;
+  while((head=ll_index_get(&jump_dirty_index,vaddr,vpage,flags,&n))!=NULL) {
+    // Don't restore blocks which are about to expire from the cache
+    if((((uintptr_t)head->addr-(uintptr_t)out)<<(32-target_size_2))>0x60000000+(MAX_OUTPUT_BLOCK_SIZE<<(32-target_size_2))) {
+      if(verify_dirty(head)==0) {
+        r4300->cached_interp.invalid_code[vaddr>>12]=0;
+        r4300->new_dynarec_hot_state.memory_map[vaddr>>12]|=WRITE_PROTECT;
+        if(vpage<2048) {
+          if(r4300->cp0.tlb.LUT_r[vaddr>>12]) {
+            r4300->cached_interp.invalid_code[r4300->cp0.tlb.LUT_r[vaddr>>12]>>12]=0;
+            r4300->new_dynarec_hot_state.memory_map[r4300->cp0.tlb.LUT_r[vaddr>>12]>>12]|=WRITE_PROTECT;
           }
-          else restore_candidate[page>>3]|=1<<(page&7);
-          return head;
+          restore_candidate[vpage>>3]|=1<<(vpage&7);
         }
+        else restore_candidate[page>>3]|=1<<(page&7);
+        return head;
       }
     }
-    head=head->next;
   }
   return NULL;
 }
@@ -2598,6 +2833,7 @@ void *dynamic_linker(void * src, u_int vaddr)
   assert((vaddr&1)==0);
   struct r4300_core* r4300 = &g_dev.r4300;
   struct ll_entry *head;
+  stats.dynamic_linker_calls++;
 
 #ifndef DISABLE_BLOCK_LINKING
   head=get_clean(r4300,vaddr,~0);
@@ -2656,6 +2892,7 @@ void *dynamic_linker_ds(void * src, u_int vaddr)
 {
   struct r4300_core* r4300 = &g_dev.r4300;
   struct ll_entry *head;
+  stats.dynamic_linker_calls++;
 
 #ifndef DISABLE_BLOCK_LINKING
   head=get_clean(r4300,vaddr,~0);
@@ -2757,6 +2994,61 @@ void *get_addr_ht(u_int vaddr)
   return get_addr(vaddr);
 }
 
+#ifdef USE_JUMP_IC
+// Called by an indirect jump which missed in its inline cache.
+// Only targets found in the hash table are cached, so that an
+// exception raised by get_addr is not skipped on the next hit.
+static void *get_addr_ic(u_int vaddr,struct jump_ic *ic)
+{
+  struct ll_entry **ht_bin=hash_table[((vaddr>>16)^vaddr)&0xFFFF];
+  void *addr=get_addr_ht(vaddr);
+  int n;
+#ifdef DBG
+  stats.jump_ic_misses++;
+#endif
+  for(n=0;n<2;n++) {
+    if(ht_bin[n]&&ht_bin[n]->vaddr==vaddr&&
+       addr==(void *)(((intptr_t)ht_bin[n]->addr-(intptr_t)base_addr)+(intptr_t)base_addr_rx)) {
+      u_int page=code_page(vaddr>>12);
+      memmove(&ic->way[1],&ic->way[0],sizeof(ic->way[0])*(JUMP_IC_WAYS-1));
+      ic->way[0].vaddr=vaddr;
+      ic->way[0].addr=addr;
+      ic->way[0].page=page;
+      jump_ic_pages[page>>5]|=1u<<(page&31);
+      break;
+    }
+  }
+  return addr;
+}
+
+static void clear_jump_ic(void)
+{
+  memset(jump_ic,-1,sizeof(jump_ic));
+  memset(jump_ic_pages,0,sizeof(jump_ic_pages));
+}
+
+// Drop the inline cache entries into the jump_in pages first..last
+static void clear_jump_ic_pages(u_int first,u_int last)
+{
+  u_int page,n,w;
+  int found=0;
+  if(last>4095) last=4095;
+  for(page=first;page<=last;page++) {
+    if(jump_ic_pages[page>>5]&(1u<<(page&31))) {
+      jump_ic_pages[page>>5]&=~(1u<<(page&31));
+      found=1;
+    }
+  }
+  if(!found) return;
+  for(n=0;n<JUMP_IC_SIZE;n++) {
+    for(w=0;w<JUMP_IC_WAYS;w++) {
+      if(jump_ic[n].way[w].page>=first&&jump_ic[n].way[w].page<=last)
+        memset(&jump_ic[n].way[w],-1,sizeof(jump_ic[n].way[w]));
+    }
+  }
+}
+#endif
+
 void *get_addr_32(u_int vaddr,u_int flags)
 {
   struct ll_entry **ht_bin=hash_table[((vaddr>>16)^vaddr)&0xFFFF];
@@ -2806,11 +3098,11 @@ static void *check_addr(u_int vaddr)
   struct ll_entry **ht_bin=hash_table[((vaddr>>16)^vaddr)&0xFFFF];
 
   if(ht_bin[0]&&ht_bin[0]->vaddr==vaddr) {
-    if((((uintptr_t)ht_bin[0]->addr-MAX_OUTPUT_BLOCK_SIZE-(uintptr_t)out)<<(32-TARGET_SIZE_2))>0x60000000+(MAX_OUTPUT_BLOCK_SIZE<<(32-TARGET_SIZE_2)))
+    if((((uintptr_t)ht_bin[0]->addr-MAX_OUTPUT_BLOCK_SIZE-(uintptr_t)out)<<(32-target_size_2))>0x60000000+(MAX_OUTPUT_BLOCK_SIZE<<(32-target_size_2)))
       if(ht_bin[0]->addr==ht_bin[0]->clean_addr) return ht_bin[0]->addr; //jump_in
   }
   if(ht_bin[1]&&ht_bin[1]->vaddr==vaddr) {
-    if((((uintptr_t)ht_bin[1]->addr-MAX_OUTPUT_BLOCK_SIZE-(uintptr_t)out)<<(32-TARGET_SIZE_2))>0x60000000+(MAX_OUTPUT_BLOCK_SIZE<<(32-TARGET_SIZE_2)))
+    if((((uintptr_t)ht_bin[1]->addr-MAX_OUTPUT_BLOCK_SIZE-(uintptr_t)out)<<(32-target_size_2))>0x60000000+(MAX_OUTPUT_BLOCK_SIZE<<(32-target_size_2)))
       if(ht_bin[1]->addr==ht_bin[1]->clean_addr) return ht_bin[1]->addr; //jump_in
   }
 
@@ -2818,7 +3110,7 @@ static void *check_addr(u_int vaddr)
   struct ll_entry *head;
   head=get_clean(r4300,vaddr,~0);
   if(head!=NULL){
-    if((((uintptr_t)head->addr-(uintptr_t)out)<<(32-TARGET_SIZE_2))>0x60000000+(MAX_OUTPUT_BLOCK_SIZE<<(32-TARGET_SIZE_2))) {
+    if((((uintptr_t)head->addr-(uintptr_t)out)<<(32-target_size_2))>0x60000000+(MAX_OUTPUT_BLOCK_SIZE<<(32-target_size_2))) {
       // Update existing entry with current address
       if(ht_bin[0]&&ht_bin[0]->vaddr==vaddr) {
         ht_bin[0]=head;
@@ -2852,15 +3144,18 @@ static void invalidate_page(u_int page)
   while(head!=NULL) {
     inv_debug("INVALIDATE: %x\n",head->vaddr);
     remove_hash(head->vaddr);
+    ll_index_remove(&jump_in_index,head);
     next=head->next;
     free(head);
     head=next;
+    stats.blocks_invalidated++;
   }
   head=jump_out[page];
   jump_out[page]=0;
   while(head!=NULL) {
     inv_debug("INVALIDATE: kill pointer to %x (%x)\n",head->vaddr,(intptr_t)head->addr);
       uintptr_t host_addr=(intptr_t)kill_pointer(head->addr);
+      stats.unlinks++;
     #if NEW_DYNAREC >= NEW_DYNAREC_ARM
       needs_clear_cache[(host_addr-(uintptr_t)base_addr)>>17]|=1<<(((host_addr-(uintptr_t)base_addr)>>12)&31);
     #else
@@ -2873,12 +3168,47 @@ static void invalidate_page(u_int page)
   }
 }
 
-void invalidate_block(u_int block)
+// Index in jump_in/jump_out of the virtual page 'block'
+static u_int code_page(u_int block)
 {
   u_int page;
   page=block^0x80000;
   if(block<0x100000&&page>262143&&g_dev.r4300.cp0.tlb.LUT_r[block]) page=(g_dev.r4300.cp0.tlb.LUT_r[block]^0x80000000)>>12;
   if(page>2048) page=2048+(page&2047);
+  return page;
+}
+
+// Check whether any block in jump_in was compiled from the RDRAM bytes at
+// offsets first..last. Blocks are at most 4 pages long and their entry points
+// can be on any of those pages, so the neighbouring pages are searched too.
+static int rdram_has_code(u_int first,u_int last)
+{
+  u_int page,end;
+  struct ll_entry *head;
+  page=(first>>12)>4?(first>>12)-4:0;
+  end=(last>>12)+4;
+  if(end>2047) end=2047;
+  for(;page<=end;page++) {
+    for(head=jump_in[page];head!=NULL;head=head->next) {
+      u_int start;
+      if(head->vaddr>=0x80000000&&head->vaddr<0x80800000)
+        start=head->start^0x80000000;
+      else {
+        uintptr_t map=g_dev.r4300.new_dynarec_hot_state.memory_map[head->vaddr>>12];
+        // Unmapped, the block can't have been compiled from RDRAM
+        if(map==(uintptr_t)-1) continue;
+        u_int paddr=head->vaddr+(map<<2)-(uintptr_t)g_dev.rdram.dram;
+        start=paddr-(head->vaddr-head->start);
+      }
+      if(start<=last&&start+head->length>first) return 1;
+    }
+  }
+  return 0;
+}
+
+static void invalidate_code_page(u_int block)
+{
+  u_int page=code_page(block);
   inv_debug("INVALIDATE: %x (%d)\n",block<<12,page);
   u_int first,last;
   first=last=page;
@@ -2920,6 +3250,9 @@ void invalidate_block(u_int block)
   invalidate_page(page);
   assert(first+5>page); // NB: this assumes MAXBLOCK<=4096 (4 pages)
   assert(last<page+5);
+  #ifdef USE_JUMP_IC
+  clear_jump_ic_pages(first,last);
+  #endif
   // Invalidate the adjacent pages if a block crosses a 4K boundary
   while(first<page) {
     invalidate_page(first);
@@ -2950,11 +3283,19 @@ void invalidate_block(u_int block)
   #endif
 }
 
+// Called by the recompiled code when it writes to a page holding code
+void invalidate_block(u_int block)
+{
+  stats.invalidations_write++;
+  invalidate_code_page(block);
+}
+
 // This is called when loading a save state.
 // Anything could have changed, so invalidate everything.
 static void invalidate_all_pages(void)
 {
   u_int page;
+  stats.invalidations_all++;
   for(page=0;page<4096;page++)
     invalidate_page(page);
   for(page=0;page<1048576;page++)
@@ -2965,11 +3306,14 @@ static void invalidate_all_pages(void)
     }
   }
   #if NEW_DYNAREC >= NEW_DYNAREC_ARM
-  cache_flush((char *)base_addr_rx,(char *)base_addr_rx+(1<<TARGET_SIZE_2));
+  cache_flush((char *)base_addr_rx,(char *)base_addr_rx+(1<<target_size_2));
   #endif
   #ifdef USE_MINI_HT
   memset(g_dev.r4300.new_dynarec_hot_state.mini_ht,-1,sizeof(g_dev.r4300.new_dynarec_hot_state.mini_ht));
   #endif
+  #ifdef USE_JUMP_IC
+  clear_jump_ic();
+  #endif
   // TLB
   for(page=0;page<0x100000;page++) {
     if(g_dev.r4300.cp0.tlb.LUT_r[page]) {
@@ -3000,7 +3344,19 @@ void invalidate_cached_code_new_dynarec(struct r4300_core* r4300, uint32_t addre
 
         for(i = begin; i <= end; ++i) {
             if(r4300->cached_interp.invalid_code[i] == 0) {
-                invalidate_block(i);
+                // DMA often lands next to code on the same page, only
+                // invalidate if it overwrites some of it (RDRAM only)
+                u_int page = code_page(i);
+                if (page < 2048) {
+                    u_int first = (i == begin) ? (address & 0xfff) : 0;
+                    u_int last = (i == end) ? ((address+size-1) & 0xfff) : 0xfff;
+                    if (!rdram_has_code((page<<12)|first, (page<<12)|last)) {
+                        stats.invalidations_skipped++;
+                        continue;
+                    }
+                }
+                stats.invalidations_external++;
+                invalidate_code_page(i);
             }
         }
     }
@@ -3018,7 +3374,7 @@ void clean_blocks(u_int page)
   while(head!=NULL) {
     if(!g_dev.r4300.cached_interp.invalid_code[head->vaddr>>12]) {
       // Don't restore blocks which are about to expire from the cache
-      if((((uintptr_t)head->addr-(uintptr_t)out)<<(32-TARGET_SIZE_2))>0x60000000+(MAX_OUTPUT_BLOCK_SIZE<<(32-TARGET_SIZE_2))) {
+      if((((uintptr_t)head->addr-(uintptr_t)out)<<(32-target_size_2))>0x60000000+(MAX_OUTPUT_BLOCK_SIZE<<(32-target_size_2))) {
         if(verify_dirty(head)==0) {
           //DebugMessage(M64MSG_VERBOSE, "Possibly Restore %x (%x)",head->vaddr, (intptr_t)head->addr);
           u_int i,j;
@@ -3049,7 +3405,7 @@ void clean_blocks(u_int page)
             inv=1;
           }
           if(!inv) {
-            if((((uintptr_t)head->clean_addr-(uintptr_t)out)<<(32-TARGET_SIZE_2))>0x60000000+(MAX_OUTPUT_BLOCK_SIZE<<(32-TARGET_SIZE_2))) {
+            if((((uintptr_t)head->clean_addr-(uintptr_t)out)<<(32-target_size_2))>0x60000000+(MAX_OUTPUT_BLOCK_SIZE<<(32-target_size_2))) {
               u_int ppage=page;
               if(page<2048&&g_dev.r4300.cp0.tlb.LUT_r[head->vaddr>>12]) ppage=(g_dev.r4300.cp0.tlb.LUT_r[head->vaddr>>12]^0x80000000)>>12;
               inv_debug("INV: Restored %x (%x/%x)\n",head->vaddr, (intptr_t)head->addr, (intptr_t)head->clean_addr);
@@ -3085,6 +3441,233 @@ void* cop1_unusable(void)
     return get_addr_ht(state->pcaddr);
 }
 
+/**** Persistent block cache ****/
+/* Remembers the entry points of the blocks compiled for a ROM so that, on the
+ * next run, they can be recompiled before they are first executed. This is
+ * deferred recompilation, not a code cache: host code isn't saved (it embeds
+ * absolute addresses of this process and would need relocating), so only the
+ * guest address, length and a hash of the guest code are stored, and every
+ * block still goes through the full recompiler on the emulation thread. What
+ * changes is when: a few blocks at interrupts instead of a burst of misses the
+ * first time a scene runs. An entry is recompiled once the code at its address
+ * hashes to the recorded value. */
+
+#define BLOCK_CACHE_MAGIC 0x4342444e // "NDBC"
+#define BLOCK_CACHE_VERSION 1
+#define BLOCK_CACHE_HEADER_SIZE 12
+#define BLOCK_CACHE_ENTRY_SIZE 16
+#define BLOCK_CACHE_MAX_ENTRIES 65536
+#define BLOCK_CACHE_PREWARM_BYTES 16384 // Guest code hashed per interrupt
+#define BLOCK_CACHE_PREWARM_BLOCKS 4    // Blocks compiled per interrupt
+
+struct block_cache_entry
+{
+  u_int vaddr;
+  u_int length; // 0 once the entry has been compiled
+  uint64_t hash;
+};
+
+static struct block_cache_entry *block_cache_loaded;
+static u_int block_cache_loaded_count;
+static u_int block_cache_remaining;
+static u_int block_cache_cursor;
+static u_int block_cache_prewarmed;
+static struct block_cache_entry *block_cache_recorded;
+static u_int block_cache_recorded_count;
+static u_int block_cache_recorded_size;
+
+static int block_cache_in_rdram(u_int vaddr,u_int length)
+{
+  u_int offset=vaddr-0x80000000;
+  if(vaddr<0x80000000||(vaddr&3)||length==0||(length&3)) return 0;
+  return offset<g_dev.rdram.dram_size&&length<=g_dev.rdram.dram_size-offset;
+}
+
+static uint64_t block_cache_hash(u_int vaddr,u_int length)
+{
+  return XXH3_64bits((const char *)g_dev.rdram.dram+(vaddr-0x80000000),length);
+}
+
+static int block_cache_compare(const void *a,const void *b)
+{
+  const struct block_cache_entry *x=(const struct block_cache_entry *)a;
+  const struct block_cache_entry *y=(const struct block_cache_entry *)b;
+  if(x->vaddr!=y->vaddr) return x->vaddr<y->vaddr?-1:1;
+  if(x->length!=y->length) return x->length<y->length?-1:1;
+  if(x->hash!=y->hash) return x->hash<y->hash?-1:1;
+  return 0;
+}
+
+// Sort and remove duplicates, returns the new number of entries
+static u_int block_cache_unique(struct block_cache_entry *entries,u_int count)
+{
+  u_int i,n=0;
+  if(count==0) return 0;
+  qsort(entries,count,sizeof(*entries),block_cache_compare);
+  for(i=1;i<count;i++)
+    if(block_cache_compare(&entries[n],&entries[i])!=0)
+      entries[++n]=entries[i];
+  return n+1;
+}
+
+static void block_cache_load(const char *path)
+{
+  void *data=NULL;
+  size_t size=0;
+  u_int i,count;
+
+  block_cache_loaded=NULL;
+  block_cache_loaded_count=block_cache_remaining=block_cache_cursor=0;
+  block_cache_prewarmed=0;
+  block_cache_recorded=NULL;
+  block_cache_recorded_count=block_cache_recorded_size=0;
+
+  if(path==NULL||load_file(path,&data,&size)!=file_ok)
+    return;
+
+  const unsigned char *p=(const unsigned char *)data;
+  if(size<BLOCK_CACHE_HEADER_SIZE||load_leu32(p)!=BLOCK_CACHE_MAGIC||load_leu32(p+4)!=BLOCK_CACHE_VERSION) {
+    DebugMessage(M64MSG_WARNING, "Ignoring invalid dynarec block cache %s", path);
+    free(data);
+    return;
+  }
+  count=load_leu32(p+8);
+  if(count==0) {
+    free(data);
+    return;
+  }
+  if(count>BLOCK_CACHE_MAX_ENTRIES||size<BLOCK_CACHE_HEADER_SIZE+(size_t)count*BLOCK_CACHE_ENTRY_SIZE) {
+    DebugMessage(M64MSG_WARNING, "Ignoring truncated dynarec block cache %s", path);
+    free(data);
+    return;
+  }
+
+  block_cache_loaded=(struct block_cache_entry *)malloc(count*sizeof(*block_cache_loaded));
+  if(block_cache_loaded==NULL) {
+    free(data);
+    return;
+  }
+  p+=BLOCK_CACHE_HEADER_SIZE;
+  for(i=0;i<count;i++,p+=BLOCK_CACHE_ENTRY_SIZE) {
+    struct block_cache_entry *e=&block_cache_loaded[block_cache_loaded_count];
+    e->vaddr=load_leu32(p);
+    e->length=load_leu32(p+4);
+    e->hash=load_leu64(p+8);
+    if(block_cache_in_rdram(e->vaddr,e->length)) block_cache_loaded_count++;
+  }
+  block_cache_remaining=block_cache_loaded_count;
+  free(data);
+
+  DebugMessage(M64MSG_INFO, "Loaded %u entries from dynarec block cache %s", block_cache_loaded_count, path);
+}
+
+static void block_cache_save(const char *path)
+{
+  u_int i,count=0;
+  struct block_cache_entry *entries;
+  unsigned char *data,*p;
+  size_t size;
+
+  if(path!=NULL&&(block_cache_recorded_count!=0||block_cache_loaded_count!=0)) {
+    // Keep the entries which were not compiled during this run, they may still be useful next time
+    entries=(struct block_cache_entry *)malloc((block_cache_recorded_count+block_cache_loaded_count)*sizeof(*entries));
+    if(entries!=NULL) {
+      for(i=0;i<block_cache_recorded_count;i++)
+        entries[count++]=block_cache_recorded[i];
+      for(i=0;i<block_cache_loaded_count;i++)
+        if(block_cache_loaded[i].length!=0)
+          entries[count++]=block_cache_loaded[i];
+      count=block_cache_unique(entries,count);
+      if(count>BLOCK_CACHE_MAX_ENTRIES) count=BLOCK_CACHE_MAX_ENTRIES;
+
+      size=BLOCK_CACHE_HEADER_SIZE+(size_t)count*BLOCK_CACHE_ENTRY_SIZE;
+      data=(unsigned char *)malloc(size);
+      if(data!=NULL) {
+        store_leu32(BLOCK_CACHE_MAGIC,data);
+        store_leu32(BLOCK_CACHE_VERSION,data+4);
+        store_leu32(count,data+8);
+        for(i=0,p=data+BLOCK_CACHE_HEADER_SIZE;i<count;i++,p+=BLOCK_CACHE_ENTRY_SIZE) {
+          store_leu32(entries[i].vaddr,p);
+          store_leu32(entries[i].length,p+4);
+          store_leu64(entries[i].hash,p+8);
+        }
+        if(write_to_file(path,data,size)!=file_ok)
+          DebugMessage(M64MSG_WARNING, "Couldn't write dynarec block cache %s", path);
+        else
+          DebugMessage(M64MSG_INFO, "Saved %u entries to dynarec block cache %s (%u blocks recompiled ahead of use)", count, path, block_cache_prewarmed);
+        free(data);
+      }
+      free(entries);
+    }
+  }
+
+  free(block_cache_loaded);
+  free(block_cache_recorded);
+  block_cache_loaded=block_cache_recorded=NULL;
+  block_cache_loaded_count=block_cache_remaining=0;
+  block_cache_recorded_count=block_cache_recorded_size=0;
+}
+
+static void block_cache_record(u_int vaddr,u_int length)
+{
+  if(!block_cache_in_rdram(vaddr,length))
+    return;
+
+  if(block_cache_recorded_count==block_cache_recorded_size) {
+    block_cache_recorded_count=block_cache_unique(block_cache_recorded,block_cache_recorded_count);
+    if(block_cache_recorded_count>=BLOCK_CACHE_MAX_ENTRIES)
+      return;
+    if(block_cache_recorded_count*2>=block_cache_recorded_size) {
+      u_int new_size=block_cache_recorded_size?block_cache_recorded_size*2:1024;
+      if(new_size>BLOCK_CACHE_MAX_ENTRIES) new_size=BLOCK_CACHE_MAX_ENTRIES;
+      struct block_cache_entry *entries=(struct block_cache_entry *)realloc(block_cache_recorded,new_size*sizeof(*entries));
+      if(entries==NULL)
+        return;
+      block_cache_recorded=entries;
+      block_cache_recorded_size=new_size;
+    }
+  }
+
+  struct block_cache_entry *e=&block_cache_recorded[block_cache_recorded_count++];
+  e->vaddr=vaddr;
+  e->length=length;
+  e->hash=block_cache_hash(vaddr,length);
+}
+
+static int block_cache_is_compiled(u_int vaddr)
+{
+  u_int page=(vaddr-0x80000000)>>12;
+  u_int n=~0u,d=~0u;
+  return ll_index_get(&jump_in_index,vaddr,page,0,&n)!=NULL||
+         ll_index_get(&jump_dirty_index,vaddr,page,0,&d)!=NULL;
+}
+
+// Called between blocks, the caller does not return into the interrupted block.
+// Runs new_recompile_block for at most BLOCK_CACHE_PREWARM_BLOCKS entries.
+static void block_cache_prewarm(void)
+{
+  u_int bytes=0,blocks=0;
+  while(block_cache_remaining!=0&&bytes<BLOCK_CACHE_PREWARM_BYTES&&blocks<BLOCK_CACHE_PREWARM_BLOCKS)
+  {
+    struct block_cache_entry *e=&block_cache_loaded[block_cache_cursor];
+    if(++block_cache_cursor==block_cache_loaded_count) block_cache_cursor=0;
+    if(e->length==0) continue;
+    if(block_cache_is_compiled(e->vaddr)) {
+      e->length=0;
+      block_cache_remaining--;
+      continue;
+    }
+    bytes+=e->length;
+    if(block_cache_hash(e->vaddr,e->length)!=e->hash) continue; // Not loaded yet (or overlaid)
+    e->length=0;
+    block_cache_remaining--;
+    if(new_recompile_block(e->vaddr)==0) {
+      blocks++;
+      block_cache_prewarmed++;
+    }
+  }
+}
+
 void dynarec_gen_interrupt(void)
 {
     struct r4300_core* r4300 = &g_dev.r4300;
@@ -3106,6 +3689,11 @@ void dynarec_gen_interrupt(void)
     }
 
     gen_interrupt(r4300);
+
+#if !defined(RECOMP_DBG)
+    if(block_cache_remaining!=0&&state->pending_exception&&!state->stop)
+        block_cache_prewarm();
+#endif
 }
 
 /**** Register allocation ****/
@@ -6172,11 +6760,95 @@ void shift_assemble(int i,struct regstat *i_regs)
 }
 #endif
 
+// Emit the access of a load, map is the register to add to the address
+static void load_assemble_access(int i,int c,u_int caddr,int addr,int temp,int map,int th,int tl)
+{
+  if (opcode[i]==0x20) { // LB
+    #ifdef HOST_IMM_ADDR32
+    if(c)
+      emit_movsbl_tlb(caddr^3,map,tl);
+    else
+    #endif
+    {
+      int x=0;
+      if(!c) emit_xorimm(addr,3,temp);
+      else x=(caddr^3)-caddr;
+      emit_movsbl_indexed_tlb(x,temp,map,tl);
+    }
+  }
+  else if (opcode[i]==0x21) { // LH
+    #ifdef HOST_IMM_ADDR32
+    if(c)
+      emit_movswl_tlb(caddr^2,map,tl);
+    else
+    #endif
+    {
+      int x=0;
+      if(!c) emit_xorimm(addr,2,temp);
+      else x=(caddr^2)-caddr;
+      emit_movswl_indexed_tlb(x,temp,map,tl);
+    }
+  }
+  else if (opcode[i]==0x23) { // LW
+    #ifdef HOST_IMM_ADDR32
+    if(c)
+      emit_readword_tlb(caddr,map,tl);
+    else
+    #endif
+    emit_readword_indexed_tlb(0,addr,map,tl);
+  }
+  else if (opcode[i]==0x24) { // LBU
+    #ifdef HOST_IMM_ADDR32
+    if(c)
+      emit_movzbl_tlb(caddr^3,map,tl);
+    else
+    #endif
+    {
+      int x=0;
+      if(!c) emit_xorimm(addr,3,temp);
+      else x=(caddr^3)-caddr;
+      emit_movzbl_indexed_tlb(x,temp,map,tl);
+    }
+  }
+  else if (opcode[i]==0x25) { // LHU
+    #ifdef HOST_IMM_ADDR32
+    if(c)
+      emit_movzwl_tlb(caddr^2,map,tl);
+    else
+    #endif
+    {
+      int x=0;
+      if(!c) emit_xorimm(addr,2,temp);
+      else x=(caddr^2)-caddr;
+      emit_movzwl_indexed_tlb(x,temp,map,tl);
+    }
+  }
+  else if (opcode[i]==0x27) { // LWU
+    assert(th>=0);
+    #ifdef HOST_IMM_ADDR32
+    if(c)
+      emit_readword_tlb(caddr,map,tl);
+    else
+    #endif
+    emit_readword_indexed_tlb(0,addr,map,tl);
+    emit_zeroreg(th);
+  }
+  else if (opcode[i]==0x37) { // LD
+    #ifdef HOST_IMM_ADDR32
+    if(c)
+      emit_readdword_tlb(caddr,map,th,tl);
+    else
+    #endif
+    emit_readdword_indexed_tlb(0,addr,map,th,tl);
+  }
+}
+
 static void load_assemble(int i,struct regstat *i_regs)
 {
   signed char s,th,tl,addr,map=-1,cache=-1;
   int offset,type=0,memtarget=0,c=0;
   intptr_t jaddr=0;
+  intptr_t rdram_jaddr=0;
   u_int hr,reglist=0;
   int agr=AGEN1+(i&1);
   th=get_reg(i_regs->regmap,rt1[i]|64);
@@ -6251,90 +6923,28 @@ static void load_assemble(int i,struct regstat *i_regs)
     cache=get_reg(i_regs->regmap,MMREG);
     assert(map>=0);
     reglist&=~(1<<map);
+    #if defined(RAM_OFFSET) && defined(NATIVE_64)
+    if(!c&&!dummy) {
+      // Even with the TLB in use, most loads are from RDRAM through kseg0.
+      // Check for that first, as without the TLB, and only look up
+      // memory_map for the other addresses.
+      emit_cmpimm(addr,0x800000);
+      intptr_t jaddr3=(intptr_t)out;
+      emit_jno(0);
+      emit_loadreg(ROREG,HOST_TEMPREG);
+      load_assemble_access(i,0,0,addr,temp,HOST_TEMPREG,th,tl);
+      rdram_jaddr=(intptr_t)out;
+      emit_jmp(0);
+      set_jump_target(jaddr3,(intptr_t)out);
+    }
+    #endif
     map=do_tlb_r(addr,temp,map,cache,x,c,constmap[i][s]+offset);
     do_tlb_r_branch(map,c,constmap[i][s]+offset,&jaddr);
   }
 
-  if((!c||memtarget)&&!dummy) {
-    if (opcode[i]==0x20) { // LB
-      #ifdef HOST_IMM_ADDR32
-      if(c)
-        emit_movsbl_tlb((constmap[i][s]+offset)^3,map,tl);
-      else
-      #endif
-      {
-        int x=0;
-        if(!c) emit_xorimm(addr,3,temp);
-        else x=((constmap[i][s]+offset)^3)-(constmap[i][s]+offset);
-        emit_movsbl_indexed_tlb(x,temp,map,tl);
-      }
-    }
-    else if (opcode[i]==0x21) { // LH
-      #ifdef HOST_IMM_ADDR32
-      if(c)
-        emit_movswl_tlb((constmap[i][s]+offset)^2,map,tl);
-      else
-      #endif
-      {
-        int x=0;
-        if(!c) emit_xorimm(addr,2,temp);
-        else x=((constmap[i][s]+offset)^2)-(constmap[i][s]+offset);
-        emit_movswl_indexed_tlb(x,temp,map,tl);
-      }
-    }
-    else if (opcode[i]==0x23) { // LW
-      #ifdef HOST_IMM_ADDR32
-      if(c)
-        emit_readword_tlb(constmap[i][s]+offset,map,tl);
-      else
-      #endif
-      emit_readword_indexed_tlb(0,addr,map,tl);
-    }
-    else if (opcode[i]==0x24) { // LBU
-      #ifdef HOST_IMM_ADDR32
-      if(c)
-        emit_movzbl_tlb((constmap[i][s]+offset)^3,map,tl);
-      else
-      #endif
-      {
-        int x=0;
-        if(!c) emit_xorimm(addr,3,temp);
-        else x=((constmap[i][s]+offset)^3)-(constmap[i][s]+offset);
-        emit_movzbl_indexed_tlb(x,temp,map,tl);
-      }
-    }
-    else if (opcode[i]==0x25) { // LHU
-      #ifdef HOST_IMM_ADDR32
-      if(c)
-        emit_movzwl_tlb((constmap[i][s]+offset)^2,map,tl);
-      else
-      #endif
-      {
-        int x=0;
-        if(!c) emit_xorimm(addr,2,temp);
-        else x=((constmap[i][s]+offset)^2)-(constmap[i][s]+offset);
-        emit_movzwl_indexed_tlb(x,temp,map,tl);
-      }
-    }
-    else if (opcode[i]==0x27) { // LWU
-      assert(th>=0);
-      #ifdef HOST_IMM_ADDR32
-      if(c)
-        emit_readword_tlb(constmap[i][s]+offset,map,tl);
-      else
-      #endif
-      emit_readword_indexed_tlb(0,addr,map,tl);
-      emit_zeroreg(th);
-    }
-    else if (opcode[i]==0x37) { // LD
-      #ifdef HOST_IMM_ADDR32
-      if(c)
-        emit_readdword_tlb(constmap[i][s]+offset,map,th,tl);
-      else
-      #endif
-      emit_readdword_indexed_tlb(0,addr,map,th,tl);
-    }
-  }
+  if((!c||memtarget)&&!dummy)
+    load_assemble_access(i,c,c?constmap[i][s]+offset:0,addr,temp,map,th,tl);
+  if(rdram_jaddr) set_jump_target(rdram_jaddr,(intptr_t)out);
   if(jaddr) {
     add_stub(type,jaddr,(intptr_t)out,i,addr,(intptr_t)i_regs,ccadj[i],reglist);
   } else if(c&&!memtarget) {
@@ -7328,7 +7938,11 @@ static void rjump_assemble(int i,struct regstat *i_regs)
     rs=0;
   }
 #endif
+    #ifdef USE_JUMP_IC
+    do_jump_ic(rs,&jump_ic[jump_ic_next++&(JUMP_IC_SIZE-1)]);
+    #else
     emit_jmp(jump_vaddr_reg[rs]);
+    #endif
   }
   #ifdef CORTEX_A8_BRANCH_PREDICTION_HACK
   if(rt1[i]!=31&&i<slen-2&&(((uintptr_t)out)&7)) emit_mov(13,13);
@@ -8696,21 +9310,42 @@ static void pagespan_ds(void)
 }
 
 /**** Recompiler ****/
+static u_int cache_size_2(u_int size_mb)
+{
+  u_int size_2=TARGET_SIZE_2_MIN;
+  while(size_2<TARGET_SIZE_2_MAX&&(1u<<(size_2+1-20))<=size_mb) size_2++;
+  return size_2;
+}
+
+static void select_cache_size(void)
+{
+  target_size_2=cache_size_2(g_dev.r4300.new_dynarec_cache_size);
+  target_size_2_limit=target_size_2;
+  // The jump table sits at the end of the cache, so it can't grow
+  if(JUMP_TABLE_SIZE==0&&cache_size_2(g_dev.r4300.new_dynarec_cache_size_max)>target_size_2)
+    target_size_2_limit=cache_size_2(g_dev.r4300.new_dynarec_cache_size_max);
+  if(g_dev.r4300.new_dynarec_cache_size!=(1u<<(target_size_2-20)))
+    DebugMessage(M64MSG_WARNING, "new dynarec cache size %u MB not supported, using %u MB",
+                 g_dev.r4300.new_dynarec_cache_size, 1u<<(target_size_2-20));
+}
+
 void new_dynarec_init(void)
 {
   DebugMessage(M64MSG_INFO, "Init new dynarec");
-  ensure_dynarec_cache_alignment();
+  select_cache_size();
 
 #if defined(RECOMPILER_DEBUG) && !defined(RECOMP_DBG)
   recomp_dbg_init();
 #endif
 
 #if !defined(RECOMP_DBG)
+  g_dev.r4300.extra_memory=(unsigned char*)alloc_cache((size_t)1<<target_size_2_limit);
+  if(g_dev.r4300.extra_memory==NULL)
+    DebugMessage(M64MSG_ERROR, "Unable to allocate %u MB new dynarec cache", 1u<<(target_size_2_limit-20));
 #if NEW_DYNAREC == NEW_DYNAREC_ARM64
 
 #define FIXED_CACHE_ADDR 1    // Put the dynarec cache at extra_memory address
-#define DYNAMIC_CACHE_ADDR 2  // Put the dynarec cache at random address
-#define DOUBLE_CACHE_ADDR 3   // Put the dynarec cache at random address with RW address != RX address
+#define DOUBLE_CACHE_ADDR 3   // Put the dynarec cache at extra_memory address with RW address != RX address
 
 // Default to fixed cache address
 #define CACHE_ADDR FIXED_CACHE_ADDR
@@ -8723,47 +9358,25 @@ void new_dynarec_init(void)
   int fd = shm_open("/new_dynarec", O_RDWR | O_CREAT | O_EXCL, 0600);
   assert(fd!=-1);
   shm_unlink("/new_dynarec");
-  ftruncate(fd, 1<<TARGET_SIZE_2);
-  base_addr = mmap((u_char *)g_dev.r4300.extra_memory, 1<<TARGET_SIZE_2,
+  ftruncate(fd, 1<<target_size_2_limit);
+  base_addr = mmap((u_char *)g_dev.r4300.extra_memory, 1<<target_size_2_limit,
                  PROT_READ | PROT_WRITE,
                  MAP_FIXED | MAP_SHARED, fd, 0);
 
   assert(base_addr!=(void*)-1);
 
-  base_addr_rx = mmap(NULL, 1<<TARGET_SIZE_2,
+  base_addr_rx = mmap(NULL, 1<<target_size_2_limit,
                  PROT_READ | PROT_EXEC,
                  MAP_SHARED, fd, 0);
 
   assert(base_addr_rx!=(void*)-1);
   close(fd);
-#elif CACHE_ADDR==FIXED_CACHE_ADDR
-  mprotect ((u_char *)g_dev.r4300.extra_memory, 1<<TARGET_SIZE_2,
-            PROT_READ | PROT_WRITE | PROT_EXEC);
+#else
   base_addr = g_dev.r4300.extra_memory;
   base_addr_rx = base_addr;
-#else /*DYNAMIC_CACHE_ADDR*/
-  base_addr = mmap (NULL, 1<<TARGET_SIZE_2,
-                    PROT_READ | PROT_WRITE | PROT_EXEC,
-                    MAP_PRIVATE | MAP_ANONYMOUS,
-                    -1, 0);
-  base_addr_rx = base_addr;
 #endif
-#elif NEW_DYNAREC == NEW_DYNAREC_ARM
-  mprotect ((u_char *)g_dev.r4300.extra_memory, 1<<TARGET_SIZE_2,
-            PROT_READ | PROT_WRITE | PROT_EXEC);
-  base_addr = g_dev.r4300.extra_memory;
-  base_addr_rx = base_addr;
 #else
-#if defined(WIN32)
-  DWORD dummy;
-  VirtualProtect((void*)g_dev.r4300.extra_memory, 33554432, PAGE_EXECUTE_READWRITE, &dummy);
   base_addr = base_addr_rx = (void*)g_dev.r4300.extra_memory;
-#else
-  mprotect ((u_char *)g_dev.r4300.extra_memory, 1<<TARGET_SIZE_2,
-            PROT_READ | PROT_WRITE | PROT_EXEC);
-  base_addr = g_dev.r4300.extra_memory;
-  base_addr_rx = base_addr;
-#endif
 #endif
 #endif
 
@@ -8781,10 +9394,17 @@ void new_dynarec_init(void)
     g_dev.r4300.cached_interp.invalid_code[n]=1;
   for(n=0;n<65536;n++)
     hash_table[n][0]=hash_table[n][1]=NULL;
+  ll_index_init(&jump_in_index,LL_INDEX_MIN_BITS);
+  ll_index_init(&jump_dirty_index,LL_INDEX_MIN_BITS);
   memset(g_dev.r4300.new_dynarec_hot_state.mini_ht,-1,sizeof(g_dev.r4300.new_dynarec_hot_state.mini_ht));
+  #ifdef USE_JUMP_IC
+  clear_jump_ic();
+  jump_ic_next=0;
+  #endif
   memset(restore_candidate,0,sizeof(restore_candidate));
   copy_size=0;
   expirep=16384; // Expiry pointer, +2 blocks
+  memset(&stats,0,sizeof(stats));
   g_dev.r4300.new_dynarec_hot_state.pending_exception=0;
   literalcount=0;
 #if defined(HOST_IMM8) || defined(NEED_INVC_PTR)
@@ -8803,6 +9423,9 @@ void new_dynarec_init(void)
 
   tlb_speed_hacks();
   arch_init();
+#if !defined(RECOMP_DBG)
+  block_cache_load(g_dev.r4300.block_cache_path);
+#endif
 }
 
 void new_dynarec_cleanup(void)
@@ -8811,25 +9434,40 @@ void new_dynarec_cleanup(void)
   recomp_dbg_cleanup();
 #endif
 
+#if !defined(RECOMP_DBG)
+  block_cache_save(g_dev.r4300.block_cache_path);
+#endif
+  DebugMessage(M64MSG_INFO, "new dynarec: %llu blocks compiled in %llu ms, cache %u MB, %llu wraps, %llu grows, %llu blocks expired",
+               (unsigned long long)stats.blocks_compiled, (unsigned long long)(stats.compile_time_ns/1000000),
+               1u<<(target_size_2-20), (unsigned long long)stats.cache_wraps, (unsigned long long)stats.cache_grows,
+               (unsigned long long)stats.blocks_expired);
+
   int n;
   for(n=0;n<4096;n++) ll_clear(jump_in+n);
   for(n=0;n<4096;n++) ll_clear(jump_out+n);
   for(n=0;n<4096;n++) ll_clear(jump_dirty+n);
   assert(copy_size==0);
+  ll_index_free(&jump_in_index);
+  ll_index_free(&jump_dirty_index);
 #if !defined(RECOMP_DBG)
-  #if defined(WIN32)
-    VirtualFree(base_addr, 0, MEM_RELEASE);
-  #elif NEW_DYNAREC == NEW_DYNAREC_ARM64 && CACHE_ADDR!=FIXED_CACHE_ADDR
-    if (munmap (base_addr_rx, 1<<TARGET_SIZE_2) < 0) {DebugMessage(M64MSG_ERROR, "munmap() failed");}
-  #else
-    mprotect(base_addr, 1<<TARGET_SIZE_2, PROT_READ | PROT_WRITE);
+  #if NEW_DYNAREC == NEW_DYNAREC_ARM64 && CACHE_ADDR==DOUBLE_CACHE_ADDR
+    if (munmap (base_addr_rx, 1<<target_size_2_limit) < 0) {DebugMessage(M64MSG_ERROR, "munmap() failed");}
   #endif
+  if(g_dev.r4300.extra_memory!=NULL)
+    free_cache(g_dev.r4300.extra_memory,(size_t)1<<target_size_2_limit);
+  g_dev.r4300.extra_memory=NULL;
 #endif
 #ifdef ROM_COPY
   if (munmap (ROM_COPY, 67108864) < 0) {DebugMessage(M64MSG_ERROR, "munmap() failed");}
 #endif
 }
 
+void new_dynarec_get_stats(m64p_dbg_dynarec_stats* dst)
+{
+  *dst=stats;
+  dst->cache_size=target_size_2?(uint64_t)1<<target_size_2:0;
+}
+
 int new_recompile_block(int addr)
 {
 #if defined(RECOMPILER_DEBUG) && !defined(RECOMP_DBG)
@@ -8837,6 +9475,7 @@ int new_recompile_block(int addr)
 #endif
 
   assem_debug("NOTCOMPILED: addr = %x -> %x", (int)addr, (intptr_t)out);
+  uint64_t compile_start=dynarec_time_ns();
 #if COUNT_NOTCOMPILEDS
   notcompiledCount++;
   DebugMessage(M64MSG_VERBOSE, "notcompiledCount=%i", notcompiledCount );
@@ -11569,9 +12208,7 @@ int new_recompile_block(int addr)
   copy_size+=((slen*4)+4);
   //DebugMessage(M64MSG_VERBOSE, "Currently used memory for copy: %d",copy_size);
 
-#if !defined(NDEBUG) || NEW_DYNAREC >= NEW_DYNAREC_ARM
   uintptr_t beginning=(uintptr_t)out;
-#endif
   if((u_int)addr&1) {
     ds=1;
     pagespan_ds();
@@ -11880,6 +12517,7 @@ int new_recompile_block(int addr)
   if(((uintptr_t)out)&7) emit_addnop(13);
   #endif
   assert((uintptr_t)out-beginning<MAX_OUTPUT_BLOCK_SIZE);
+  stats.bytes_emitted+=(uintptr_t)out-beginning;
   memcpy(copy,(char*)source,slen*4);
   u_int *ptr=(u_int*)copy;
   ptr[slen]=dirty_entry_count;
@@ -11889,11 +12527,29 @@ int new_recompile_block(int addr)
   intptr_t out_rx=((intptr_t)out-(intptr_t)base_addr)+(intptr_t)base_addr_rx;
   cache_flush((char *)beginning_rx,(char *)out_rx);
   #endif
+#if !defined(RECOMP_DBG)
+  perf_map_add((void *)(((intptr_t)beginning-(intptr_t)base_addr)+(intptr_t)base_addr_rx),(uintptr_t)out-beginning,start);
+#endif
 
   // If we're within 256K of the end of the buffer,
   // start over from the beginning. (Is 256K enough?)
-  if(out > (u_char *)((u_char *)base_addr+(1<<TARGET_SIZE_2)-MAX_OUTPUT_BLOCK_SIZE-JUMP_TABLE_SIZE))
-    out=(u_char *)base_addr;
+  if(out > (u_char *)((u_char *)base_addr+(1<<target_size_2)-MAX_OUTPUT_BLOCK_SIZE-JUMP_TABLE_SIZE)) {
+    if(target_size_2<target_size_2_limit) {
+      // Keep going into the reserved space instead, nothing expires.
+      // The expiry pointer is rescaled to the new size.
+      target_size_2++;
+      expirep=((((intptr_t)out-(intptr_t)base_addr)>>(target_size_2-16))+16384)&65535;
+      stats.cache_grows++;
+      #ifdef USE_JUMP_IC
+      clear_jump_ic();
+      #endif
+      DebugMessage(M64MSG_VERBOSE, "new dynarec cache grown to %u MB", 1u<<(target_size_2-20));
+    }
+    else {
+      out=(u_char *)base_addr;
+      stats.cache_wraps++;
+    }
+  }
 
   // Trap writes to any of the pages we compiled
   for(i=start>>12;i<=(int)((start+slen*4-4)>>12);i++) {
@@ -11911,19 +12567,19 @@ int new_recompile_block(int addr)
 
   /* Pass 10 - Free memory by expiring oldest blocks */
 
-  int end=((((intptr_t)out-(intptr_t)base_addr)>>(TARGET_SIZE_2-16))+16384)&65535;
+  int end=((((intptr_t)out-(intptr_t)base_addr)>>(target_size_2-16))+16384)&65535;
   while(expirep!=end)
   {
-    int shift=TARGET_SIZE_2-3; // Divide into 8 blocks
+    int shift=target_size_2-3; // Divide into 8 blocks
     intptr_t base=(intptr_t)base_addr+((expirep>>13)<<shift); // Base address of this block
     inv_debug("EXP: Phase %d\n",expirep);
     switch((expirep>>11)&3)
     {
       case 0:
         // Clear jump_in and jump_dirty
-        ll_remove_matching_addrs(jump_in+(expirep&2047),base,shift);
+        stats.blocks_expired+=ll_remove_matching_addrs(jump_in+(expirep&2047),base,shift);
         ll_remove_matching_addrs(jump_dirty+(expirep&2047),base,shift);
-        ll_remove_matching_addrs(jump_in+2048+(expirep&2047),base,shift);
+        stats.blocks_expired+=ll_remove_matching_addrs(jump_in+2048+(expirep&2047),base,shift);
         ll_remove_matching_addrs(jump_dirty+2048+(expirep&2047),base,shift);
         break;
       case 1:
@@ -11956,9 +12612,21 @@ int new_recompile_block(int addr)
         #endif
         ll_remove_matching_addrs(jump_out+(expirep&2047),base,shift);
         ll_remove_matching_addrs(jump_out+2048+(expirep&2047),base,shift);
+        #ifdef USE_JUMP_IC
+        // Last step for this block, drop any inline cache entries into it
+        if((expirep&2047)==2047)
+          clear_jump_ic();
+        #endif
         break;
     }
     expirep=(expirep+1)&65535;
+    stats.expiry_steps++;
   }
+  stats.blocks_compiled++;
+  stats.compile_time_ns+=dynarec_time_ns()-compile_start;
+#if !defined(RECOMP_DBG)
+  if(g_dev.r4300.block_cache_path!=NULL&&!((u_int)addr&1))
+    block_cache_record(start,slen*4);
+#endif
   return 0;
 }
@@ -22,6 +22,7 @@
 #ifndef M64P_DEVICE_R4300_NEW_DYNAREC_H
 #define M64P_DEVICE_R4300_NEW_DYNAREC_H
 
+#include "api/m64p_types.h"
 #include "device/r4300/recomp_types.h" /* for precomp_instr */
 
 #include <stddef.h>
@@ -32,9 +33,6 @@
 #define NEW_DYNAREC_ARM 3
 #define NEW_DYNAREC_ARM64 4
 
-#define NEW_DYNAREC_CACHE_SIZE       (1u << 25)
-#define NEW_DYNAREC_CACHE_PAGE_PAD   0x200000u
-
 #define WRITE_PROTECT ((uintptr_t)1<<((sizeof(uintptr_t)<<3)-2))
 
 struct r4300_core;
@@ -96,5 +94,6 @@ void invalidate_cached_code_new_dynarec(struct r4300_core* r4300, uint32_t addre
 void new_dynarec_init(void);
 void new_dyna_start(void);
 void new_dynarec_cleanup(void);
+void new_dynarec_get_stats(m64p_dbg_dynarec_stats* stats);
 
 #endif /* M64P_DEVICE_R4300_NEW_DYNAREC_H */
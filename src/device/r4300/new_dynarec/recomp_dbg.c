@@ -66,6 +66,7 @@
 #define cop1_unusable                           recomp_dbg_cop1_unusable
 #define dynamic_linker                          recomp_dbg_dynamic_linker
 #define dynamic_linker_ds                       recomp_dbg_dynamic_linker_ds
+#define new_dynarec_get_stats                   recomp_dbg_new_dynarec_get_stats
 
 #if RECOMPILER_DEBUG == 3 //ARM
 static void jump_vaddr_r0(void){}
@@ -133,8 +134,6 @@ static void __clear_cache(char* begin, char *end){}
 static int disasm_block[] = {0xa4000040};
 
 #include "device/r4300/new_dynarec/new_dynarec.h"
-#include "osal/preproc.h" //for ALIGN
-ALIGN(4096, static unsigned char recomp_dbg_extra_memory_buffer[NEW_DYNAREC_CACHE_SIZE + NEW_DYNAREC_CACHE_PAGE_PAD]);
 static unsigned char* recomp_dbg_extra_memory;
 
 // Recompile new_dynarec.c with the above redefinitions
@@ -815,11 +814,10 @@ static void replace_addr(intptr_t real_addr, intptr_t addr, size_t addr_size, Va
 
 void recomp_dbg_init(void)
 {
-  if (recomp_dbg_extra_memory == NULL) {
-    recomp_dbg_extra_memory = (unsigned char*)
-        dynarec_align_cache_buffer(recomp_dbg_extra_memory_buffer,
-                                   sizeof(recomp_dbg_extra_memory_buffer));
-  }
+  select_cache_size();
+  recomp_dbg_extra_memory = (unsigned char*)alloc_cache((size_t)1<<target_size_2_limit);
+  if (recomp_dbg_extra_memory == NULL)
+    DebugMessage(M64MSG_ERROR, "Unable to allocate recompiler debug cache");
 
   var[0].addr = (uintptr_t)g_dev.rdram.dram - 0x80000000;
   var[0].size = g_dev.rdram.dram_size;
@@ -831,9 +829,12 @@ void recomp_dbg_init(void)
 
   for(int n=0;n<65536;n++)
     hash_table[n][0]=hash_table[n][1]=NULL;
+  ll_index_init(&jump_in_index,LL_INDEX_MIN_BITS);
+  ll_index_init(&jump_dirty_index,LL_INDEX_MIN_BITS);
 
   copy_size=0;
   expirep=16384; // Expiry pointer, +2 blocks
+  memset(&stats,0,sizeof(stats));
   literalcount=0;
 
   arch_init();
@@ -844,9 +845,9 @@ void recomp_dbg_init(void)
 
  #if RECOMPILER_DEBUG >= NEW_DYNAREC_ARM
   FILE * pFile = osal_file_open ("jump_table.txt","w");
-  uintptr_t * src = (uintptr_t *)((char *)base_addr+(1<<TARGET_SIZE_2)-JUMP_TABLE_SIZE);
+  uintptr_t * src = (uintptr_t *)((char *)base_addr+(1<<target_size_2)-JUMP_TABLE_SIZE);
 
-  while((char *)src<(char *)base_addr+(1<<TARGET_SIZE_2))
+  while((char *)src<(char *)base_addr+(1<<target_size_2))
   {
     cs_insn *instr;
     size_t count = cs_disasm(handle, (uint8_t*)src, sizeof(uintptr_t), (uintptr_t)src, 0, &instr);
@@ -878,7 +879,12 @@ void recomp_dbg_cleanup(void)
   for(int n=0;n<4096;n++) ll_clear(jump_in+n);
   for(int n=0;n<4096;n++) ll_clear(jump_out+n);
   for(int n=0;n<4096;n++) ll_clear(jump_dirty+n);
+  ll_index_free(&jump_in_index);
+  ll_index_free(&jump_dirty_index);
   assert(copy_size==0);
+  if (recomp_dbg_extra_memory != NULL)
+    free_cache(recomp_dbg_extra_memory, (size_t)1<<target_size_2_limit);
+  recomp_dbg_extra_memory = NULL;
 
   /* Capstone cleanup */
   if(handle == 0) return;
@@ -37,6 +37,24 @@ void invalidate_block_edi(void);
 static const u_int const_zero=0;
 static const u_int const_one=1;
 
+// Masks for abs/neg (andps/xorps need 16-byte aligned memory operands)
+ALIGN(16, static const uint64_t sign_mask_s[2]) = {0x8000000080000000ULL,0x8000000080000000ULL};
+ALIGN(16, static const uint64_t sign_mask_d[2]) = {0x8000000000000000ULL,0x8000000000000000ULL};
+ALIGN(16, static const uint64_t abs_mask_s[2]) = {0x7fffffff7fffffffULL,0x7fffffff7fffffffULL};
+ALIGN(16, static const uint64_t abs_mask_d[2]) = {0x7fffffffffffffffULL,0x7fffffffffffffffULL};
+
+// Used by set_rounding_mode to update the rounding bits of MXCSR
+static u_int mxcsr_temp;
+
+// FPR cache, see float_assemble
+#define FPR_CACHE_FIRST 1 // xmm0 is used as a scratch register
+#define FPR_CACHE_LAST 5  // xmm6-xmm15 are callee-saved on Win64
+static signed char fpr_cache_reg[FPR_CACHE_LAST+1]; // COP1 register held in each xmm, -1 if none
+static char fpr_cache_dirty[FPR_CACHE_LAST+1];
+static u_int fpr_cache_used[FPR_CACHE_LAST+1];     // Least recently used is replaced first
+static u_int fpr_cache_clock;
+static int fpr_cache_fmt; // 0x10 (single) or 0x11 (double)
+
 static const uintptr_t jump_vaddr_reg[8] = {
   (uintptr_t)jump_vaddr_eax,
   (uintptr_t)jump_vaddr_ecx,
@@ -1944,6 +1962,25 @@ static void emit_submem64(intptr_t addr,int hr)
 }
 #endif
 
+// Used by the indirect jump inline caches
+static void emit_jmpmem(intptr_t addr)
+{
+  assert(addr-(intptr_t)out>-2147483648LL&&addr-(intptr_t)out<2147483647LL);
+  assem_debug("jmp *%llx",addr);
+  output_byte(0xFF);
+  output_modrm(0,5,4);
+  output_w32((intptr_t)addr-(intptr_t)out-4); // Note: rip-relative in 64-bit mode
+}
+static void emit_incmem64(intptr_t addr)
+{
+  assert(addr-(intptr_t)out>-2147483648LL&&addr-(intptr_t)out<2147483647LL);
+  assem_debug("incq %llx",addr);
+  output_rex(1,0,0,0);
+  output_byte(0xFF);
+  output_modrm(0,5,0);
+  output_w32((intptr_t)addr-(intptr_t)out-4); // Note: rip-relative in 64-bit mode
+}
+
 static void emit_readword(intptr_t addr, int rt)
 {
   assert((intptr_t)addr-(intptr_t)out>=-2147483648LL&&(intptr_t)addr-(intptr_t)out<2147483647LL);
@@ -2677,11 +2714,9 @@ static void emit_readdword_dualindexed(int offset, int base,int rs,int rt)
   }
 }
 
-// special case for checking memory_map in verify_mapping
-#if 0
+// Used by the indirect jump inline caches
 static void emit_cmpmem(intptr_t addr,int rt)
 {
-  assert(0);
   assert((intptr_t)addr-(intptr_t)out>=-2147483648LL&&(intptr_t)addr-(intptr_t)out<2147483647LL);
   assert(rt>=0&&rt<8);
   assem_debug("cmp %llx,%%%s",addr,regname[rt]);
@@ -2689,7 +2724,6 @@ static void emit_cmpmem(intptr_t addr,int rt)
   output_modrm(0,5,rt);
   output_w32((intptr_t)addr-(intptr_t)out-4); // Note: rip-relative in 64-bit mode
 }
-#endif
 
 // Used to preload hash table entries
 #ifdef IMM_PREFETCH
@@ -2740,104 +2774,6 @@ static void emit_fucomip(u_int r)
   output_byte(0xdf);
   output_byte(0xe8+r);
 }
-static void emit_fchs(void)
-{
-  assem_debug("fchs");
-  output_byte(0xd9);
-  output_byte(0xe0);
-}
-static void emit_fabs(void)
-{
-  assem_debug("fabs");
-  output_byte(0xd9);
-  output_byte(0xe1);
-}
-static void emit_fsqrt(void)
-{
-  assem_debug("fsqrt");
-  output_byte(0xd9);
-  output_byte(0xfa);
-}
-static void emit_fadds(int r)
-{
-  assem_debug("fadds (%%%s)",regname[r]);
-  output_byte(0xd8);
-  if(r!=EBP) output_modrm(0,r,0);
-  else {output_modrm(1,EBP,0);output_byte(0);}
-}
-static void emit_faddl(int r)
-{
-  assem_debug("faddl (%%%s)",regname[r]);
-  output_byte(0xdc);
-  if(r!=EBP) output_modrm(0,r,0);
-  else {output_modrm(1,EBP,0);output_byte(0);}
-}
-static void emit_fadd(int r)
-{
-  assem_debug("fadd st%d",r);
-  output_byte(0xd8);
-  output_byte(0xc0+r);
-}
-static void emit_fsubs(int r)
-{
-  assem_debug("fsubs (%%%s)",regname[r]);
-  output_byte(0xd8);
-  if(r!=EBP) output_modrm(0,r,4);
-  else {output_modrm(1,EBP,4);output_byte(0);}
-}
-static void emit_fsubl(int r)
-{
-  assem_debug("fsubl (%%%s)",regname[r]);
-  output_byte(0xdc);
-  if(r!=EBP) output_modrm(0,r,4);
-  else {output_modrm(1,EBP,4);output_byte(0);}
-}
-static void emit_fsub(int r)
-{
-  assem_debug("fsub st%d",r);
-  output_byte(0xd8);
-  output_byte(0xe0+r);
-}
-static void emit_fmuls(int r)
-{
-  assem_debug("fmuls (%%%s)",regname[r]);
-  output_byte(0xd8);
-  if(r!=EBP) output_modrm(0,r,1);
-  else {output_modrm(1,EBP,1);output_byte(0);}
-}
-static void emit_fmull(int r)
-{
-  assem_debug("fmull (%%%s)",regname[r]);
-  output_byte(0xdc);
-  if(r!=EBP) output_modrm(0,r,1);
-  else {output_modrm(1,EBP,1);output_byte(0);}
-}
-static void emit_fmul(int r)
-{
-  assem_debug("fmul st%d",r);
-  output_byte(0xd8);
-  output_byte(0xc8+r);
-}
-static void emit_fdivs(int r)
-{
-  assem_debug("fdivs (%%%s)",regname[r]);
-  output_byte(0xd8);
-  if(r!=EBP) output_modrm(0,r,6);
-  else {output_modrm(1,EBP,6);output_byte(0);}
-}
-static void emit_fdivl(int r)
-{
-  assem_debug("fdivl (%%%s)",regname[r]);
-  output_byte(0xdc);
-  if(r!=EBP) output_modrm(0,r,6);
-  else {output_modrm(1,EBP,6);output_byte(0);}
-}
-static void emit_fdiv(int r)
-{
-  assem_debug("fdiv st%d",r);
-  output_byte(0xd8);
-  output_byte(0xf0+r);
-}
 static void emit_fpop(void)
 {
   // fstp st(0)
@@ -2979,6 +2915,95 @@ static void emit_cvttpd2dq(u_int ssereg1,u_int ssereg2)
   output_byte(0xe6);
   output_modrm(3,ssereg1,ssereg2);
 }
+static void emit_movss_store(u_int ssereg,u_int addr)
+{
+  assem_debug("movss xmm%d,(%%%s)",ssereg,regname[addr]);
+  assert(ssereg<8);
+  output_byte(0xf3);
+  output_byte(0x0f);
+  output_byte(0x11);
+  if(addr!=EBP) output_modrm(0,addr,ssereg);
+  else {output_modrm(1,EBP,ssereg);output_byte(0);}
+}
+static void emit_movsd_store(u_int ssereg,u_int addr)
+{
+  assem_debug("movsd xmm%d,(%%%s)",ssereg,regname[addr]);
+  assert(ssereg<8);
+  output_byte(0xf2);
+  output_byte(0x0f);
+  output_byte(0x11);
+  if(addr!=EBP) output_modrm(0,addr,ssereg);
+  else {output_modrm(1,EBP,ssereg);output_byte(0);}
+}
+static void emit_movaps(u_int ssereg1,u_int ssereg2)
+{
+  assem_debug("movaps xmm%d,xmm%d",ssereg1,ssereg2);
+  assert(ssereg1<8);
+  assert(ssereg2<8);
+  output_byte(0x0f);
+  output_byte(0x28);
+  output_modrm(3,ssereg1,ssereg2);
+}
+// Scalar arithmetic: prefix 0xf3 (single) or 0xf2 (double)
+static void emit_sse_scalar(u_char prefix,u_char op,const char *name,u_int ssereg1,u_int ssereg2)
+{
+  assem_debug("%s%s xmm%d,xmm%d",name,prefix==0xf3?"ss":"sd",ssereg1,ssereg2);
+  assert(ssereg1<8);
+  assert(ssereg2<8);
+  output_byte(prefix);
+  output_byte(0x0f);
+  output_byte(op);
+  output_modrm(3,ssereg1,ssereg2);
+}
+// Bitwise operation with a constant: prefix 0 (ps) or 0x66 (pd)
+static void emit_sse_logic_rip(u_char prefix,u_char op,const char *name,intptr_t addr,u_int ssereg)
+{
+  assert((intptr_t)addr-(intptr_t)out>=-2147483648LL&&(intptr_t)addr-(intptr_t)out<2147483647LL);
+  assert((addr&15)==0);
+  assert(ssereg<8);
+  assem_debug("%s%s %llx,xmm%d",name,prefix?"pd":"ps",addr,ssereg);
+  if(prefix) output_byte(prefix);
+  output_byte(0x0f);
+  output_byte(op);
+  output_modrm(0,5,ssereg);
+  output_w32(addr-(intptr_t)out-4); // Note: rip-relative in 64-bit mode
+}
+static void emit_stmxcsr(intptr_t addr)
+{
+  assert((intptr_t)addr-(intptr_t)out>=-2147483648LL&&(intptr_t)addr-(intptr_t)out<2147483647LL);
+  assem_debug("stmxcsr %llx",addr);
+  output_byte(0x0f);
+  output_byte(0xae);
+  output_modrm(0,5,3);
+  output_w32(addr-(intptr_t)out-4); // Note: rip-relative in 64-bit mode
+}
+static void emit_ldmxcsr(intptr_t addr)
+{
+  assert((intptr_t)addr-(intptr_t)out>=-2147483648LL&&(intptr_t)addr-(intptr_t)out<2147483647LL);
+  assem_debug("ldmxcsr %llx",addr);
+  output_byte(0x0f);
+  output_byte(0xae);
+  output_modrm(0,5,2);
+  output_w32(addr-(intptr_t)out-4); // Note: rip-relative in 64-bit mode
+}
+static void emit_andmem_imm(intptr_t addr,int imm)
+{
+  assert((intptr_t)addr-(intptr_t)out>=-2147483648LL&&(intptr_t)addr-(intptr_t)out<2147483647LL);
+  assem_debug("andl $%d,%llx",imm,addr);
+  output_byte(0x81);
+  output_modrm(0,5,4);
+  output_w32(addr-(intptr_t)out-8); // Note: rip-relative in 64-bit mode, from the end of the immediate
+  output_w32(imm);
+}
+static void emit_ormem(int rs,intptr_t addr)
+{
+  assert((intptr_t)addr-(intptr_t)out>=-2147483648LL&&(intptr_t)addr-(intptr_t)out<2147483647LL);
+  assert(rs<8);
+  assem_debug("orl %%%s,%llx",regname[rs],addr);
+  output_byte(0x09);
+  output_modrm(0,5,rs);
+  output_w32(addr-(intptr_t)out-4); // Note: rip-relative in 64-bit mode
+}
 
 static unsigned int count_bits(u_int reglist)
 {
@@ -3182,6 +3207,14 @@ static void set_rounding_mode(int s,int temp)
   emit_and(s,temp,temp);
   emit_lea_rip((intptr_t)g_dev.r4300.new_dynarec_hot_state.rounding_modes, HOST_TEMPREG);
   emit_fldcw_indexedx4(HOST_TEMPREG, temp);
+  // FLOAT instructions use SSE, MXCSR.RC = (-mode)&3 (0:nearest 3:zero 2:up 1:down)
+  emit_neg(temp,temp);
+  emit_andimm(temp,3,temp);
+  emit_shlimm(temp,13,temp);
+  emit_stmxcsr((intptr_t)&mxcsr_temp);
+  emit_andmem_imm((intptr_t)&mxcsr_temp,~0x6000);
+  emit_ormem(temp,(intptr_t)&mxcsr_temp);
+  emit_ldmxcsr((intptr_t)&mxcsr_temp);
 }
 
 /* Special assem */
@@ -3940,14 +3973,120 @@ static void fcomp_assemble(int i,struct regstat *i_regs)
   emit_loadreg(FSREG,fs);
 }
 
+/* FPR cache */
+// Consecutive FLOAT instructions keep their operands in xmm registers and
+// only store them after the last one. Nothing else is emitted between two
+// instructions that could read them (the main loop only moves GPRs), and a
+// run ends before any branch target, so no other code can enter it.
+
+static void fpr_cache_reset(void)
+{
+  int x;
+  for(x=FPR_CACHE_FIRST;x<=FPR_CACHE_LAST;x++) {
+    fpr_cache_reg[x]=-1;
+    fpr_cache_dirty[x]=0;
+  }
+}
+
+static intptr_t fpr_cache_ptr(int r)
+{
+  if(fpr_cache_fmt==0x10) return (intptr_t)&g_dev.r4300.new_dynarec_hot_state.cp1_regs_simple[r];
+  return (intptr_t)&g_dev.r4300.new_dynarec_hot_state.cp1_regs_double[r];
+}
+
+static void fpr_cache_load(int r,int x,int temp)
+{
+  emit_readptr(fpr_cache_ptr(r),temp);
+  if(fpr_cache_fmt==0x10) emit_movss_load(temp,x);
+  else emit_movsd_load(temp,x);
+}
+
+static void fpr_cache_store(int x,int r,int temp)
+{
+  emit_readptr(fpr_cache_ptr(r),temp);
+  if(fpr_cache_fmt==0x10) emit_movss_store(x,temp);
+  else emit_movsd_store(x,temp);
+}
+
+static void fpr_cache_free(int x,int temp)
+{
+  if(fpr_cache_dirty[x]) fpr_cache_store(x,fpr_cache_reg[x],temp);
+  fpr_cache_reg[x]=-1;
+  fpr_cache_dirty[x]=0;
+}
+
+static void fpr_cache_flush(int temp)
+{
+  int x;
+  for(x=FPR_CACHE_FIRST;x<=FPR_CACHE_LAST;x++)
+    if(fpr_cache_reg[x]>=0) fpr_cache_free(x,temp);
+}
+
+// Returns the xmm register holding COP1 register r, loading it if needed
+static int fpr_cache_get(int r,int load,int temp)
+{
+  int x,found=-1;
+  for(x=FPR_CACHE_FIRST;x<=FPR_CACHE_LAST;x++) {
+    if(fpr_cache_reg[x]==r) found=x;
+    // With FR=0, double registers r and r^1 are the same memory
+    else if(fpr_cache_fmt==0x11&&fpr_cache_reg[x]==(r^1)) {
+      assert(fpr_cache_used[x]!=fpr_cache_clock);
+      fpr_cache_free(x,temp);
+    }
+  }
+  if(found<0) {
+    for(x=FPR_CACHE_FIRST;x<=FPR_CACHE_LAST;x++) {
+      if(fpr_cache_reg[x]<0) {found=x;break;}
+      if(fpr_cache_used[x]!=fpr_cache_clock&&(found<0||fpr_cache_used[x]<fpr_cache_used[found])) found=x;
+    }
+    assert(found>=0);
+    if(fpr_cache_reg[found]>=0) fpr_cache_free(found,temp);
+    fpr_cache_reg[found]=r;
+    if(load) fpr_cache_load(r,found,temp);
+  }
+  fpr_cache_used[found]=fpr_cache_clock;
+  return found;
+}
+
+// Whether instruction i+1 can use the registers cached by instruction i
+static int fpr_cache_continues(int i)
+{
+  return !is_delayslot&&i+1<slen&&itype[i+1]==FLOAT&&!bt[i+1]&&opcode2[i+1]==opcode2[i];
+}
+
+// x = x op y, or x = op x for sqrt, abs and neg
+static void emit_float_op(int op,int fmt,int y,int x)
+{
+  u_char prefix=fmt==0x10?0xf3:0xf2;
+  switch(op)
+  {
+    case 0x00: emit_sse_scalar(prefix,0x58,"add",y,x);break;
+    case 0x01: emit_sse_scalar(prefix,0x5c,"sub",y,x);break;
+    case 0x02: emit_sse_scalar(prefix,0x59,"mul",y,x);break;
+    case 0x03: emit_sse_scalar(prefix,0x5e,"div",y,x);break;
+    case 0x04: emit_sse_scalar(prefix,0x51,"sqrt",x,x);break;
+    case 0x05:
+      if(fmt==0x10) emit_sse_logic_rip(0,0x54,"and",(intptr_t)abs_mask_s,x);
+      else emit_sse_logic_rip(0x66,0x54,"and",(intptr_t)abs_mask_d,x);
+      break;
+    case 0x07:
+      if(fmt==0x10) emit_sse_logic_rip(0,0x57,"xor",(intptr_t)sign_mask_s,x);
+      else emit_sse_logic_rip(0x66,0x57,"xor",(intptr_t)sign_mask_d,x);
+      break;
+  }
+}
+
 static void float_assemble(int i,struct regstat *i_regs)
 {
   signed char temp=get_reg(i_regs->regmap,-1);
   assert(temp>=0);
+  // A run of cached registers starts here
+  if(is_delayslot||i==0||!fpr_cache_continues(i-1)) fpr_cache_reset();
   // Check cop1 unusable
   if(!cop1_usable) {
     signed char cs=get_reg(i_regs->regmap,CSREG);
     assert(cs>=0);
+    fpr_cache_flush(temp);
     emit_testimm(cs,CP0_STATUS_CU1);
     intptr_t jaddr=(intptr_t)out;
     emit_jeq(0);
@@ -3956,99 +4095,72 @@ static void float_assemble(int i,struct regstat *i_regs)
   }
 
 #ifndef INTERPRET_FLOAT
-  if((source[i]&0x3f)==6) // mov
   {
-    if(((source[i]>>11)&0x1f)!=((source[i]>>6)&0x1f)) {
-      if(opcode2[i]==0x10) {
-        emit_readptr((intptr_t)&g_dev.r4300.new_dynarec_hot_state.cp1_regs_simple[(source[i]>>11)&0x1f],temp);
-        emit_flds(temp);
-        emit_readptr((intptr_t)&g_dev.r4300.new_dynarec_hot_state.cp1_regs_simple[(source[i]>>6)&0x1f],temp);
-        emit_fstps(temp);
-      }
-      if(opcode2[i]==0x11) {
-        emit_readptr((intptr_t)&g_dev.r4300.new_dynarec_hot_state.cp1_regs_double[(source[i]>>11)&0x1f],temp);
-        emit_fldl(temp);
-        emit_readptr((intptr_t)&g_dev.r4300.new_dynarec_hot_state.cp1_regs_double[(source[i]>>6)&0x1f],temp);
-        emit_fstpl(temp);
+    int op=source[i]&0x3f;
+    int fs=(source[i]>>11)&0x1f;
+    int ft=(source[i]>>16)&0x1f;
+    int fd=(source[i]>>6)&0x1f;
+    int xs,xt,xd;
+    fpr_cache_fmt=opcode2[i];
+    fpr_cache_clock++;
+
+    if(opcode2[i]==0x11&&((fs^ft)==1||(fs^fd)==1||(ft^fd)==1)) {
+      // The operands may overlap (FR=0), access them in memory order
+      fpr_cache_flush(temp);
+      if(op!=6||fs!=fd) {
+        fpr_cache_load(fs,1,temp);
+        if(op<4) {
+          fpr_cache_load(ft,2,temp);
+          emit_float_op(op,opcode2[i],2,1);
+        }
+        else emit_float_op(op,opcode2[i],-1,1);
+        fpr_cache_store(1,fd,temp);
       }
+      return;
     }
-    return;
-  }
 
-  if((source[i]&0x3f)>3)
-  {
-    if(opcode2[i]==0x10) {
-      emit_readptr((intptr_t)&g_dev.r4300.new_dynarec_hot_state.cp1_regs_simple[(source[i]>>11)&0x1f],temp);
-      emit_flds(temp);
-      if(((source[i]>>11)&0x1f)!=((source[i]>>6)&0x1f)) {
-        emit_readptr((intptr_t)&g_dev.r4300.new_dynarec_hot_state.cp1_regs_simple[(source[i]>>6)&0x1f],temp);
+    if(op==6) // mov
+    {
+      if(fs!=fd) {
+        xs=fpr_cache_get(fs,1,temp);
+        xd=fpr_cache_get(fd,0,temp);
+        emit_movaps(xs,xd);
+        fpr_cache_dirty[xd]=1;
       }
     }
-    if(opcode2[i]==0x11) {
-      emit_readptr((intptr_t)&g_dev.r4300.new_dynarec_hot_state.cp1_regs_double[(source[i]>>11)&0x1f],temp);
-      emit_fldl(temp);
-      if(((source[i]>>11)&0x1f)!=((source[i]>>6)&0x1f)) {
-        emit_readptr((intptr_t)&g_dev.r4300.new_dynarec_hot_state.cp1_regs_double[(source[i]>>6)&0x1f],temp);
+    else if(op>3) // sqrt, abs, neg
+    {
+      xs=fpr_cache_get(fs,1,temp);
+      xd=xs;
+      if(fd!=fs) {
+        xd=fpr_cache_get(fd,0,temp);
+        emit_movaps(xs,xd);
       }
+      emit_float_op(op,opcode2[i],-1,xd);
+      fpr_cache_dirty[xd]=1;
     }
-    if((source[i]&0x3f)==4) // sqrt
-      emit_fsqrt();
-    if((source[i]&0x3f)==5) // abs
-      emit_fabs();
-    if((source[i]&0x3f)==7) // neg
-      emit_fchs();
-    if(opcode2[i]==0x10) {
-      emit_fstps(temp);
-    }
-    if(opcode2[i]==0x11) {
-      emit_fstpl(temp);
-    }
-    return;
-  }
-  if((source[i]&0x3f)<4)
-  {
-    if(opcode2[i]==0x10) {
-      emit_readptr((intptr_t)&g_dev.r4300.new_dynarec_hot_state.cp1_regs_simple[(source[i]>>11)&0x1f],temp);
-      emit_flds(temp);
-    }
-    if(opcode2[i]==0x11) {
-      emit_readptr((intptr_t)&g_dev.r4300.new_dynarec_hot_state.cp1_regs_double[(source[i]>>11)&0x1f],temp);
-      emit_fldl(temp);
-    }
-    if(((source[i]>>11)&0x1f)!=((source[i]>>16)&0x1f)) {
-      if(opcode2[i]==0x10) {
-        emit_readptr((intptr_t)&g_dev.r4300.new_dynarec_hot_state.cp1_regs_simple[(source[i]>>16)&0x1f],temp);
-        if((source[i]&0x3f)==0) emit_fadds(temp);
-        if((source[i]&0x3f)==1) emit_fsubs(temp);
-        if((source[i]&0x3f)==2) emit_fmuls(temp);
-        if((source[i]&0x3f)==3) emit_fdivs(temp);
+    else // add, sub, mul, div
+    {
+      xs=fpr_cache_get(fs,1,temp);
+      xt=fpr_cache_get(ft,1,temp);
+      if(fd==fs) {
+        xd=xs;
+        emit_float_op(op,opcode2[i],xt,xd);
       }
-      else if(opcode2[i]==0x11) {
-        emit_readptr((intptr_t)&g_dev.r4300.new_dynarec_hot_state.cp1_regs_double[(source[i]>>16)&0x1f],temp);
-        if((source[i]&0x3f)==0) emit_faddl(temp);
-        if((source[i]&0x3f)==1) emit_fsubl(temp);
-        if((source[i]&0x3f)==2) emit_fmull(temp);
-        if((source[i]&0x3f)==3) emit_fdivl(temp);
+      else if(fd==ft) {
+        xd=xt;
+        emit_movaps(xs,0);
+        emit_float_op(op,opcode2[i],xt,0);
+        emit_movaps(0,xd);
       }
-    }
-    else {
-      if((source[i]&0x3f)==0) emit_fadd(0);
-      if((source[i]&0x3f)==1) emit_fsub(0);
-      if((source[i]&0x3f)==2) emit_fmul(0);
-      if((source[i]&0x3f)==3) emit_fdiv(0);
-    }
-    if(opcode2[i]==0x10) {
-      if(((source[i]>>16)&0x1f)!=((source[i]>>6)&0x1f)) {
-        emit_readptr((intptr_t)&g_dev.r4300.new_dynarec_hot_state.cp1_regs_simple[(source[i]>>6)&0x1f],temp);
-      }
-      emit_fstps(temp);
-    }
-    if(opcode2[i]==0x11) {
-      if(((source[i]>>16)&0x1f)!=((source[i]>>6)&0x1f)) {
-        emit_readptr((intptr_t)&g_dev.r4300.new_dynarec_hot_state.cp1_regs_double[(source[i]>>6)&0x1f],temp);
+      else {
+        xd=fpr_cache_get(fd,0,temp);
+        emit_movaps(xs,xd);
+        emit_float_op(op,opcode2[i],xt,xd);
       }
-      emit_fstpl(temp);
+      fpr_cache_dirty[xd]=1;
     }
+    if(!fpr_cache_continues(i)) fpr_cache_flush(temp);
     return;
   }
 #endif
@@ -4316,6 +4428,26 @@ static void do_miniht_insert(int return_address,int rt,int temp) {
   emit_writedword(temp,(intptr_t)&g_dev.r4300.new_dynarec_hot_state.mini_ht[(return_address&0x1FF)>>4][1]);
 }
 
+static void do_jump_ic(int rs,struct jump_ic *ic) {
+  uintptr_t jaddr;
+  int n;
+  for(n=0;n<JUMP_IC_WAYS;n++) {
+    emit_cmpmem((intptr_t)&ic->way[n].vaddr,rs);
+    jaddr=(uintptr_t)out;
+    emit_jne(0);
+#ifdef DBG
+    emit_incmem64((intptr_t)&stats.jump_ic_hits);
+#endif
+    emit_jmpmem((intptr_t)&ic->way[n].addr);
+    set_jump_target(jaddr,(uintptr_t)out);
+  }
+  // Miss, look up the target and update the cache
+  if(rs!=ARG1_REG) emit_mov(rs,ARG1_REG);
+  emit_lea_rip((intptr_t)ic,ARG2_REG);
+  emit_call((intptr_t)get_addr_ic);
+  emit_jmpreg(EAX);
+}
+
 // We don't need this for x64
 static void literal_pool(int n) {}
 static void literal_pool_jumpover(int n) {}
@@ -4323,6 +4455,7 @@ static void literal_pool_jumpover(int n) {}
 // CPU-architecture-specific initialization
 static void arch_init()
 {
+  fpr_cache_reset();
   g_dev.r4300.new_dynarec_hot_state.rounding_modes[0]=0x33F; // round
   g_dev.r4300.new_dynarec_hot_state.rounding_modes[1]=0xF3F; // trunc
   g_dev.r4300.new_dynarec_hot_state.rounding_modes[2]=0xB3F; // ceil
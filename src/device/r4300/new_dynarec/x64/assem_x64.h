@@ -40,8 +40,9 @@
 //#define DESTRUCTIVE_WRITEBACK 1
 #define DESTRUCTIVE_SHIFT 1
 #define USE_MINI_HT 1
+#define USE_JUMP_IC 1
 
-#define TARGET_SIZE_2 25 // 2^25 = 32 megabytes
+#define TARGET_SIZE_2_MAX 27 // Largest code cache: 2^27 = 128 megabytes
 #define JUMP_TABLE_SIZE 0 // Not needed for x86
 
 #ifdef _WIN32
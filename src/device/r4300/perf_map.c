@@ -0,0 +1,242 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus - perf_map.c                                              *
+ *   Mupen64Plus homepage: https://mupen64plus.org/                        *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "perf_map.h"
+
+#include "api/callbacks.h"
+#include "api/m64p_types.h"
+
+#if defined(__linux__)
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+/* jitdump format, see tools/perf/Documentation/jitdump-specification.txt
+ * in the Linux sources */
+#define JITDUMP_MAGIC 0x4A695444
+#define JITDUMP_VERSION 1
+#define JIT_CODE_LOAD 0
+#define JIT_CODE_CLOSE 3
+
+#if defined(__x86_64__)
+#define JITDUMP_ELF_MACH 62  /* EM_X86_64 */
+#elif defined(__i386__)
+#define JITDUMP_ELF_MACH 3   /* EM_386 */
+#elif defined(__aarch64__)
+#define JITDUMP_ELF_MACH 183 /* EM_AARCH64 */
+#elif defined(__arm__)
+#define JITDUMP_ELF_MACH 40  /* EM_ARM */
+#else
+#define JITDUMP_ELF_MACH 0
+#endif
+
+struct jitdump_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t total_size;
+    uint32_t elf_mach;
+    uint32_t pad1;
+    uint32_t pid;
+    uint64_t timestamp;
+    uint64_t flags;
+};
+
+struct jitdump_record_header
+{
+    uint32_t id;
+    uint32_t total_size;
+    uint64_t timestamp;
+};
+
+struct jitdump_code_load
+{
+    struct jitdump_record_header header;
+    uint32_t pid;
+    uint32_t tid;
+    uint64_t vma;
+    uint64_t code_addr;
+    uint64_t code_size;
+    uint64_t code_index;
+    /* followed by the null terminated name and the code */
+};
+
+static FILE* l_perf_map;
+static FILE* l_jitdump;
+static void* l_jitdump_marker;
+static size_t l_jitdump_marker_size;
+static uint64_t l_jitdump_index;
+
+/* perf record -k mono uses the same clock */
+static uint64_t jitdump_timestamp(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+static FILE* jitdump_open(const char* filename)
+{
+    struct jitdump_header header;
+    FILE* f;
+    int fd = open(filename, O_CREAT | O_TRUNC | O_RDWR, 0666);
+    if (fd < 0)
+        return NULL;
+
+    /* perf finds the dump through this mapping in its mmap events */
+    l_jitdump_marker_size = (size_t)sysconf(_SC_PAGESIZE);
+    l_jitdump_marker = mmap(NULL, l_jitdump_marker_size, PROT_READ | PROT_EXEC, MAP_PRIVATE, fd, 0);
+    if (l_jitdump_marker == MAP_FAILED)
+    {
+        l_jitdump_marker = NULL;
+        close(fd);
+        return NULL;
+    }
+
+    f = fdopen(fd, "wb");
+    if (f == NULL)
+    {
+        munmap(l_jitdump_marker, l_jitdump_marker_size);
+        l_jitdump_marker = NULL;
+        close(fd);
+        return NULL;
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.magic = JITDUMP_MAGIC;
+    header.version = JITDUMP_VERSION;
+    header.total_size = sizeof(header);
+    header.elf_mach = JITDUMP_ELF_MACH;
+    header.pid = (uint32_t)getpid();
+    header.timestamp = jitdump_timestamp();
+    fwrite(&header, sizeof(header), 1, f);
+    l_jitdump_index = 0;
+    return f;
+}
+
+static void jitdump_close(void)
+{
+    struct jitdump_record_header record;
+    record.id = JIT_CODE_CLOSE;
+    record.total_size = sizeof(record);
+    record.timestamp = jitdump_timestamp();
+    fwrite(&record, sizeof(record), 1, l_jitdump);
+    fclose(l_jitdump);
+    l_jitdump = NULL;
+    munmap(l_jitdump_marker, l_jitdump_marker_size);
+    l_jitdump_marker = NULL;
+}
+
+void perf_map_open(unsigned int outputs)
+{
+    char filename[64];
+
+    perf_map_close();
+
+    if (outputs & PERF_MAP_TEXT)
+    {
+        snprintf(filename, sizeof(filename), "/tmp/perf-%d.map", (int)getpid());
+        l_perf_map = fopen(filename, "w");
+        if (l_perf_map == NULL)
+            DebugMessage(M64MSG_WARNING, "Couldn't open %s for writing", filename);
+        else
+            DebugMessage(M64MSG_INFO, "Writing perf map to %s", filename);
+    }
+
+    if (outputs & PERF_MAP_JITDUMP)
+    {
+        snprintf(filename, sizeof(filename), "/tmp/jit-%d.dump", (int)getpid());
+        l_jitdump = jitdump_open(filename);
+        if (l_jitdump == NULL)
+            DebugMessage(M64MSG_WARNING, "Couldn't open %s for writing", filename);
+        else
+            DebugMessage(M64MSG_INFO, "Writing jitdump to %s", filename);
+    }
+}
+
+void perf_map_close(void)
+{
+    if (l_perf_map != NULL)
+    {
+        fclose(l_perf_map);
+        l_perf_map = NULL;
+    }
+    if (l_jitdump != NULL)
+        jitdump_close();
+}
+
+void perf_map_add(const void* code, size_t size, uint32_t mips_addr)
+{
+    char name[16];
+    int name_length;
+
+    if ((l_perf_map == NULL && l_jitdump == NULL) || size == 0)
+        return;
+
+    name_length = snprintf(name, sizeof(name), "n64_%08x", mips_addr);
+
+    if (l_perf_map != NULL)
+    {
+        /* Flushed every time so that the map is complete even if the
+         * emulator is killed while being profiled */
+        fprintf(l_perf_map, "%lx %lx %s\n", (unsigned long)(uintptr_t)code, (unsigned long)size, name);
+        fflush(l_perf_map);
+    }
+
+    if (l_jitdump != NULL)
+    {
+        struct jitdump_code_load record;
+        record.header.id = JIT_CODE_LOAD;
+        record.header.total_size = (uint32_t)(sizeof(record) + name_length + 1 + size);
+        record.header.timestamp = jitdump_timestamp();
+        record.pid = (uint32_t)getpid();
+        record.tid = (uint32_t)syscall(SYS_gettid);
+        record.vma = (uint64_t)(uintptr_t)code;
+        record.code_addr = (uint64_t)(uintptr_t)code;
+        record.code_size = size;
+        record.code_index = l_jitdump_index++;
+        fwrite(&record, sizeof(record), 1, l_jitdump);
+        fwrite(name, name_length + 1, 1, l_jitdump);
+        fwrite(code, size, 1, l_jitdump);
+    }
+}
+
+#else
+
+void perf_map_open(unsigned int outputs)
+{
+    if (outputs != PERF_MAP_NONE)
+        DebugMessage(M64MSG_WARNING, "perf map output is only supported on Linux");
+}
+
+void perf_map_close(void)
+{
+}
+
+void perf_map_add(const void* code, size_t size, uint32_t mips_addr)
+{
+}
+
+#endif
@@ -0,0 +1,41 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus - perf_map.h                                              *
+ *   Mupen64Plus homepage: https://mupen64plus.org/                        *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef M64P_DEVICE_R4300_PERF_MAP_H
+#define M64P_DEVICE_R4300_PERF_MAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Outputs describing the code emitted by the dynarecs to Linux perf */
+enum perf_map_output
+{
+    PERF_MAP_NONE    = 0,
+    PERF_MAP_TEXT    = 1, /* /tmp/perf-<pid>.map, read by perf report */
+    PERF_MAP_JITDUMP = 2  /* /tmp/jit-<pid>.dump, for perf inject --jit */
+};
+
+void perf_map_open(unsigned int outputs);
+void perf_map_close(void);
+
+/* Record the host code generated for the MIPS code at mips_addr */
+void perf_map_add(const void* code, size_t size, uint32_t mips_addr);
+
+#endif /* M64P_DEVICE_R4300_PERF_MAP_H */
@@ -22,6 +22,7 @@
 #include "pure_interp.h"
 
 #include <stdint.h>
+#include <stdlib.h>
 
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
@@ -29,7 +30,9 @@
 #include "api/callbacks.h"
 #include "api/debugger.h"
 #include "api/m64p_types.h"
+#include "device/memory/memory.h"
 #include "device/r4300/r4300_core.h"
+#include "device/rdram/rdram.h"
 #include "osal/preproc.h"
 
 #ifdef DBG
@@ -37,6 +40,19 @@
 #endif
 
 
+typedef void (*pure_interp_handler)(struct r4300_core* r4300, uint32_t op);
+
+/* Decoded instructions of a 4KB page of RDRAM.
+ * A NULL handler means the instruction hasn't been decoded yet. */
+struct pure_interp_page
+{
+	struct pure_interp_entry
+	{
+		pure_interp_handler handler;
+		uint32_t op;
+	} entries[0x400];
+};
+
 static void InterpretOpcode(struct r4300_core* r4300);
 
 #define DECLARE_R4300
@@ -162,290 +178,224 @@ static void InterpretOpcode(struct r4300_core* r4300);
 
 #include "mips_instructions.def"
 
-void InterpretOpcode(struct r4300_core* r4300)
+/* Returns the handler of the instruction op found at address pc */
+static pure_interp_handler decode_opcode(struct r4300_core* r4300, uint32_t op, uint32_t pc)
 {
-	uint32_t* op_address = fast_mem_access(r4300, *r4300_pc(r4300));
-	if (op_address == NULL)
-		return;
-	uint32_t op = *op_address;
-
 	switch ((op >> 26) & 0x3F) {
 	case 0: /* SPECIAL prefix */
 		switch (op & 0x3F) {
 		case 0: /* SPECIAL opcode 0: SLL */
-			if (RD_OF(op) != 0) SLL(r4300, op);
-			else                NOP(r4300, 0);
-			break;
+			if (RD_OF(op) != 0) return SLL;
+			else                return NOP;
 		case 2: /* SPECIAL opcode 2: SRL */
-			if (RD_OF(op) != 0) SRL(r4300, op);
-			else                NOP(r4300, 0);
-			break;
+			if (RD_OF(op) != 0) return SRL;
+			else                return NOP;
 		case 3: /* SPECIAL opcode 3: SRA */
-			if (RD_OF(op) != 0) SRA(r4300, op);
-			else                NOP(r4300, 0);
-			break;
+			if (RD_OF(op) != 0) return SRA;
+			else                return NOP;
 		case 4: /* SPECIAL opcode 4: SLLV */
-			if (RD_OF(op) != 0) SLLV(r4300, op);
-			else                NOP(r4300, 0);
-			break;
+			if (RD_OF(op) != 0) return SLLV;
+			else                return NOP;
 		case 6: /* SPECIAL opcode 6: SRLV */
-			if (RD_OF(op) != 0) SRLV(r4300, op);
-			else                NOP(r4300, 0);
-			break;
+			if (RD_OF(op) != 0) return SRLV;
+			else                return NOP;
 		case 7: /* SPECIAL opcode 7: SRAV */
-			if (RD_OF(op) != 0) SRAV(r4300, op);
-			else                NOP(r4300, 0);
-			break;
-		case 8: JR(r4300, op); break;
+			if (RD_OF(op) != 0) return SRAV;
+			else                return NOP;
+		case 8: return JR;
 		case 9: /* SPECIAL opcode 9: JALR */
 			/* Note: This can omit the check for Rd == 0 because the JALR
 			 * function checks for link_register != &r4300_regs(4300)[0]. If you're
 			 * using this as a reference for a JIT, do check Rd == 0 in it. */
-			JALR(r4300, op);
-			break;
-		case 12: SYSCALL(r4300, op); break;
+			return JALR;
+		case 12: return SYSCALL;
 		case 13: /* SPECIAL opcode 13: BREAK */
-			BREAK(r4300, op);
-			break;
-		case 15: SYNC(r4300, op); break;
+			return BREAK;
+		case 15: return SYNC;
 		case 16: /* SPECIAL opcode 16: MFHI */
-			if (RD_OF(op) != 0) MFHI(r4300, op);
-			else                NOP(r4300, 0);
-			break;
-		case 17: MTHI(r4300, op); break;
+			if (RD_OF(op) != 0) return MFHI;
+			else                return NOP;
+		case 17: return MTHI;
 		case 18: /* SPECIAL opcode 18: MFLO */
-			if (RD_OF(op) != 0) MFLO(r4300, op);
-			else                NOP(r4300, 0);
-			break;
-		case 19: MTLO(r4300, op); break;
+			if (RD_OF(op) != 0) return MFLO;
+			else                return NOP;
+		case 19: return MTLO;
 		case 20: /* SPECIAL opcode 20: DSLLV */
-			if (RD_OF(op) != 0) DSLLV(r4300, op);
-			else                NOP(r4300, 0);
-			break;
+			if (RD_OF(op) != 0) return DSLLV;
+			else                return NOP;
 		case 22: /* SPECIAL opcode 22: DSRLV */
-			if (RD_OF(op) != 0) DSRLV(r4300, op);
-			else                NOP(r4300, 0);
-			break;
+			if (RD_OF(op) != 0) return DSRLV;
+			else                return NOP;
 		case 23: /* SPECIAL opcode 23: DSRAV */
-			if (RD_OF(op) != 0) DSRAV(r4300, op);
-			else                NOP(r4300, 0);
-			break;
-		case 24: MULT(r4300, op); break;
-		case 25: MULTU(r4300, op); break;
-		case 26: DIV(r4300, op); break;
-		case 27: DIVU(r4300, op); break;
-		case 28: DMULT(r4300, op); break;
-		case 29: DMULTU(r4300, op); break;
-		case 30: DDIV(r4300, op); break;
-		case 31: DDIVU(r4300, op); break;
+			if (RD_OF(op) != 0) return DSRAV;
+			else                return NOP;
+		case 24: return MULT;
+		case 25: return MULTU;
+		case 26: return DIV;
+		case 27: return DIVU;
+		case 28: return DMULT;
+		case 29: return DMULTU;
+		case 30: return DDIV;
+		case 31: return DDIVU;
 		case 32: /* SPECIAL opcode 32: ADD */
-			if (RD_OF(op) != 0) ADD(r4300, op);
-			else                NOP(r4300, 0);
-			break;
+			if (RD_OF(op) != 0) return ADD;
+			else                return NOP;
 		case 33: /* SPECIAL opcode 33: ADDU */
-			if (RD_OF(op) != 0) ADDU(r4300, op);
-			else                NOP(r4300, 0);
-			break;
+			if (RD_OF(op) != 0) return ADDU;
+			else                return NOP;
 		case 34: /* SPECIAL opcode 34: SUB */
-			if (RD_OF(op) != 0) SUB(r4300, op);
-			else                NOP(r4300, 0);
-			break;
+			if (RD_OF(op) != 0) return SUB;
+			else                return NOP;
 		case 35: /* SPECIAL opcode 35: SUBU */
-			if (RD_OF(op) != 0) SUBU(r4300, op);
-			else                NOP(r4300, 0);
-			break;
+			if (RD_OF(op) != 0) return SUBU;
+			else                return NOP;
 		case 36: /* SPECIAL opcode 36: AND */
-			if (RD_OF(op) != 0) AND(r4300, op);
-			else                NOP(r4300, 0);
-			break;
+			if (RD_OF(op) != 0) return AND;
+			else                return NOP;
 		case 37: /* SPECIAL opcode 37: OR */
-			if (RD_OF(op) != 0) OR(r4300, op);
-			else                NOP(r4300, 0);
-			break;
+			if (RD_OF(op) != 0) return OR;
+			else                return NOP;
 		case 38: /* SPECIAL opcode 38: XOR */
-			if (RD_OF(op) != 0) XOR(r4300, op);
-			else                NOP(r4300, 0);
-			break;
+			if (RD_OF(op) != 0) return XOR;
+			else                return NOP;
 		case 39: /* SPECIAL opcode 39: NOR */
-			if (RD_OF(op) != 0) NOR(r4300, op);
-			else                NOP(r4300, 0);
-			break;
+			if (RD_OF(op) != 0) return NOR;
+			else                return NOP;
 		case 42: /* SPECIAL opcode 42: SLT */
-			if (RD_OF(op) != 0) SLT(r4300, op);
-			else                NOP(r4300, 0);
-			break;
+			if (RD_OF(op) != 0) return SLT;
+			else                return NOP;
 		case 43: /* SPECIAL opcode 43: SLTU */
-			if (RD_OF(op) != 0) SLTU(r4300, op);
-			else                NOP(r4300, 0);
-			break;
+			if (RD_OF(op) != 0) return SLTU;
+			else                return NOP;
 		case 44: /* SPECIAL opcode 44: DADD */
-			if (RD_OF(op) != 0) DADD(r4300, op);
-			else                NOP(r4300, 0);
-			break;
+			if (RD_OF(op) != 0) return DADD;
+			else                return NOP;
 		case 45: /* SPECIAL opcode 45: DADDU */
-			if (RD_OF(op) != 0) DADDU(r4300, op);
-			else                NOP(r4300, 0);
-			break;
+			if (RD_OF(op) != 0) return DADDU;
+			else                return NOP;
 		case 46: /* SPECIAL opcode 46: DSUB */
-			if (RD_OF(op) != 0) DSUB(r4300, op);
-			else                NOP(r4300, 0);
-			break;
+			if (RD_OF(op) != 0) return DSUB;
+			else                return NOP;
 		case 47: /* SPECIAL opcode 47: DSUBU */
-			if (RD_OF(op) != 0) DSUBU(r4300, op);
-			else                NOP(r4300, 0);
-			break;
-		case 48: TGE(r4300, op); break;
-		case 49: TGEU(r4300, op); break;
-		case 50: TLT(r4300, op); break;
-		case 51: TLTU(r4300, op); break;
-		case 52: TEQ(r4300, op); break;
-		case 54: TNE(r4300, op); break;
+			if (RD_OF(op) != 0) return DSUBU;
+			else                return NOP;
+		case 48: return TGE;
+		case 49: return TGEU;
+		case 50: return TLT;
+		case 51: return TLTU;
+		case 52: return TEQ;
+		case 54: return TNE;
 		case 56: /* SPECIAL opcode 56: DSLL */
-			if (RD_OF(op) != 0) DSLL(r4300, op);
-			else                NOP(r4300, 0);
-			break;
+			if (RD_OF(op) != 0) return DSLL;
+			else                return NOP;
 		case 58: /* SPECIAL opcode 58: DSRL */
-			if (RD_OF(op) != 0) DSRL(r4300, op);
-			else                NOP(r4300, 0);
-			break;
+			if (RD_OF(op) != 0) return DSRL;
+			else                return NOP;
 		case 59: /* SPECIAL opcode 59: DSRA */
-			if (RD_OF(op) != 0) DSRA(r4300, op);
-			else                NOP(r4300, 0);
-			break;
+			if (RD_OF(op) != 0) return DSRA;
+			else                return NOP;
 		case 60: /* SPECIAL opcode 60: DSLL32 */
-			if (RD_OF(op) != 0) DSLL32(r4300, op);
-			else                NOP(r4300, 0);
-			break;
+			if (RD_OF(op) != 0) return DSLL32;
+			else                return NOP;
 		case 62: /* SPECIAL opcode 62: DSRL32 */
-			if (RD_OF(op) != 0) DSRL32(r4300, op);
-			else                NOP(r4300, 0);
-			break;
+			if (RD_OF(op) != 0) return DSRL32;
+			else                return NOP;
 		case 63: /* SPECIAL opcode 63: DSRA32 */
-			if (RD_OF(op) != 0) DSRA32(r4300, op);
-			else                NOP(r4300, 0);
-			break;
+			if (RD_OF(op) != 0) return DSRA32;
+			else                return NOP;
 		default: /* SPECIAL opcodes 1, 5, 10, 11, 14, 21, 40, 41, 53, 55, 57,
 		            61: Reserved Instructions */
-			RESERVED(r4300, op);
-			break;
+			return RESERVED;
 		} /* switch (op & 0x3F) for the SPECIAL prefix */
-		break;
 	case 1: /* REGIMM prefix */
 		switch ((op >> 16) & 0x1F) {
 		case 0: /* REGIMM opcode 0: BLTZ */
-			if (IS_RELATIVE_IDLE_LOOP(r4300, op, *r4300_pc(r4300))) BLTZ_IDLE(r4300, op);
-			else                                             BLTZ(r4300, op);
-			break;
+			if (IS_RELATIVE_IDLE_LOOP(r4300, op, pc)) return BLTZ_IDLE;
+			else                                      return BLTZ;
 		case 1: /* REGIMM opcode 1: BGEZ */
-			if (IS_RELATIVE_IDLE_LOOP(r4300, op, *r4300_pc(r4300))) BGEZ_IDLE(r4300, op);
-			else                                             BGEZ(r4300, op);
-			break;
+			if (IS_RELATIVE_IDLE_LOOP(r4300, op, pc)) return BGEZ_IDLE;
+			else                                      return BGEZ;
 		case 2: /* REGIMM opcode 2: BLTZL */
-			if (IS_RELATIVE_IDLE_LOOP(r4300, op, *r4300_pc(r4300))) BLTZL_IDLE(r4300, op);
-			else                                             BLTZL(r4300, op);
-			break;
+			if (IS_RELATIVE_IDLE_LOOP(r4300, op, pc)) return BLTZL_IDLE;
+			else                                      return BLTZL;
 		case 3: /* REGIMM opcode 3: BGEZL */
-			if (IS_RELATIVE_IDLE_LOOP(r4300, op, *r4300_pc(r4300))) BGEZL_IDLE(r4300, op);
-			else                                             BGEZL(r4300, op);
-			break;
-		case 8: TGEI(r4300, op); break;
-		case 9: TGEIU(r4300, op); break;
-		case 10: TLTI(r4300, op); break;
-		case 11: TLTIU(r4300, op); break;
-		case 12: TEQI(r4300, op); break;
-		case 14: TNEI(r4300, op); break;
+			if (IS_RELATIVE_IDLE_LOOP(r4300, op, pc)) return BGEZL_IDLE;
+			else                                      return BGEZL;
+		case 8: return TGEI;
+		case 9: return TGEIU;
+		case 10: return TLTI;
+		case 11: return TLTIU;
+		case 12: return TEQI;
+		case 14: return TNEI;
 		case 16: /* REGIMM opcode 16: BLTZAL */
-			if (IS_RELATIVE_IDLE_LOOP(r4300, op, *r4300_pc(r4300))) BLTZAL_IDLE(r4300, op);
-			else                                             BLTZAL(r4300, op);
-			break;
+			if (IS_RELATIVE_IDLE_LOOP(r4300, op, pc)) return BLTZAL_IDLE;
+			else                                      return BLTZAL;
 		case 17: /* REGIMM opcode 17: BGEZAL */
-			if (IS_RELATIVE_IDLE_LOOP(r4300, op, *r4300_pc(r4300))) BGEZAL_IDLE(r4300, op);
-			else                                             BGEZAL(r4300, op);
-			break;
+			if (IS_RELATIVE_IDLE_LOOP(r4300, op, pc)) return BGEZAL_IDLE;
+			else                                      return BGEZAL;
 		case 18: /* REGIMM opcode 18: BLTZALL */
-			if (IS_RELATIVE_IDLE_LOOP(r4300, op, *r4300_pc(r4300))) BLTZALL_IDLE(r4300, op);
-			else                                             BLTZALL(r4300, op);
-			break;
+			if (IS_RELATIVE_IDLE_LOOP(r4300, op, pc)) return BLTZALL_IDLE;
+			else                                      return BLTZALL;
 		case 19: /* REGIMM opcode 19: BGEZALL */
-			if (IS_RELATIVE_IDLE_LOOP(r4300, op, *r4300_pc(r4300))) BGEZALL_IDLE(r4300, op);
-			else                                             BGEZALL(r4300, op);
-			break;
+			if (IS_RELATIVE_IDLE_LOOP(r4300, op, pc)) return BGEZALL_IDLE;
+			else                                      return BGEZALL;
 		default: /* REGIMM opcodes 4..7, 13, 15, 20..31:
 		            Reserved Instructions */
-			RESERVED(r4300, op);
-			break;
+			return RESERVED;
 		} /* switch ((op >> 16) & 0x1F) for the REGIMM prefix */
-		break;
 	case 2: /* Major opcode 2: J */
-		if (IS_ABSOLUTE_IDLE_LOOP(r4300, op, *r4300_pc(r4300))) J_IDLE(r4300, op);
-		else                                             J(r4300, op);
-		break;
+		if (IS_ABSOLUTE_IDLE_LOOP(r4300, op, pc)) return J_IDLE;
+		else                                      return J;
 	case 3: /* Major opcode 3: JAL */
-		if (IS_ABSOLUTE_IDLE_LOOP(r4300, op, *r4300_pc(r4300))) JAL_IDLE(r4300, op);
-		else                                             JAL(r4300, op);
-		break;
+		if (IS_ABSOLUTE_IDLE_LOOP(r4300, op, pc)) return JAL_IDLE;
+		else                                      return JAL;
 	case 4: /* Major opcode 4: BEQ */
-		if (IS_RELATIVE_IDLE_LOOP(r4300, op, *r4300_pc(r4300))) BEQ_IDLE(r4300, op);
-		else                                             BEQ(r4300, op);
-		break;
+		if (IS_RELATIVE_IDLE_LOOP(r4300, op, pc)) return BEQ_IDLE;
+		else                                      return BEQ;
 	case 5: /* Major opcode 5: BNE */
-		if (IS_RELATIVE_IDLE_LOOP(r4300, op, *r4300_pc(r4300))) BNE_IDLE(r4300, op);
-		else                                             BNE(r4300, op);
-		break;
+		if (IS_RELATIVE_IDLE_LOOP(r4300, op, pc)) return BNE_IDLE;
+		else                                      return BNE;
 	case 6: /* Major opcode 6: BLEZ */
-		if (IS_RELATIVE_IDLE_LOOP(r4300, op, *r4300_pc(r4300))) BLEZ_IDLE(r4300, op);
-		else                                             BLEZ(r4300, op);
-		break;
+		if (IS_RELATIVE_IDLE_LOOP(r4300, op, pc)) return BLEZ_IDLE;
+		else                                      return BLEZ;
 	case 7: /* Major opcode 7: BGTZ */
-		if (IS_RELATIVE_IDLE_LOOP(r4300, op, *r4300_pc(r4300))) BGTZ_IDLE(r4300, op);
-		else                                             BGTZ(r4300, op);
-		break;
+		if (IS_RELATIVE_IDLE_LOOP(r4300, op, pc)) return BGTZ_IDLE;
+		else                                      return BGTZ;
 	case 8: /* Major opcode 8: ADDI */
-		if (RT_OF(op) != 0) ADDI(r4300, op);
-		else                NOP(r4300, 0);
-		break;
+		if (RT_OF(op) != 0) return ADDI;
+		else                return NOP;
 	case 9: /* Major opcode 9: ADDIU */
-		if (RT_OF(op) != 0) ADDIU(r4300, op);
-		else                NOP(r4300, 0);
-		break;
+		if (RT_OF(op) != 0) return ADDIU;
+		else                return NOP;
 	case 10: /* Major opcode 10: SLTI */
-		if (RT_OF(op) != 0) SLTI(r4300, op);
-		else                NOP(r4300, 0);
-		break;
+		if (RT_OF(op) != 0) return SLTI;
+		else                return NOP;
 	case 11: /* Major opcode 11: SLTIU */
-		if (RT_OF(op) != 0) SLTIU(r4300, op);
-		else                NOP(r4300, 0);
-		break;
+		if (RT_OF(op) != 0) return SLTIU;
+		else                return NOP;
 	case 12: /* Major opcode 12: ANDI */
-		if (RT_OF(op) != 0) ANDI(r4300, op);
-		else                NOP(r4300, 0);
-		break;
+		if (RT_OF(op) != 0) return ANDI;
+		else                return NOP;
 	case 13: /* Major opcode 13: ORI */
-		if (RT_OF(op) != 0) ORI(r4300, op);
-		else                NOP(r4300, 0);
-		break;
+		if (RT_OF(op) != 0) return ORI;
+		else                return NOP;
 	case 14: /* Major opcode 14: XORI */
-		if (RT_OF(op) != 0) XORI(r4300, op);
-		else                NOP(r4300, 0);
-		break;
+		if (RT_OF(op) != 0) return XORI;
+		else                return NOP;
 	case 15: /* Major opcode 15: LUI */
-		if (RT_OF(op) != 0) LUI(r4300, op);
-		else                NOP(r4300, 0);
-		break;
+		if (RT_OF(op) != 0) return LUI;
+		else                return NOP;
 	case 16: /* Coprocessor 0 prefix */
 		switch ((op >> 21) & 0x1F) {
 		case 0: /* Coprocessor 0 opcode 0: MFC0  */
-			if (RT_OF(op) != 0) MFC0(r4300, op);
-			else                NOP(r4300, 0);
-			break;
+			if (RT_OF(op) != 0) return MFC0;
+			else                return NOP;
 		case 1: /* Coprocessor 0 opcode 1: DMFC0 */
-			if (RT_OF(op) != 0) DMFC0(r4300, op);
-			else                NOP(r4300, 0);
-			break;
+			if (RT_OF(op) != 0) return DMFC0;
+			else                return NOP;
 		case 4: /* Coprocessor 0 opcode 4: MTC0  */
 		case 5: /* Coprocessor 0 opcode 5: DMTC0 */
-			MTC0(r4300, op);
-			break;
+			return MTC0;
 		case 2:
 		case 3:
 		case 6:
@@ -458,305 +408,362 @@ void InterpretOpcode(struct r4300_core* r4300)
 		case 13:
 		case 14:
 		case 15: /* Coprocessor 0 opcodes 2..3, 6..15: Reserved Instructions */
-			RESERVED(r4300, op);
-			break;
+			return RESERVED;
 		default: /* Coprocessor 0 opcode 16..31: TLB */
 			switch (op & 0x3F) {
-			case 1: TLBR(r4300, op); break;
-			case 2: TLBWI(r4300, op); break;
-			case 6: TLBWR(r4300, op); break;
-			case 8: TLBP(r4300, op); break;
-			case 24: ERET(r4300, op); break;
+			case 1: return TLBR;
+			case 2: return TLBWI;
+			case 6: return TLBWR;
+			case 8: return TLBP;
+			case 24: return ERET;
 			default: /* TLB sub-opcodes 0, 3..5, 7, 9..23, 25..63: undefined */
-				NOP(r4300, 0);
-				break;
+				return NOP;
 			} /* switch (op & 0x3F) for Coprocessor 0 TLB opcodes */
-			break;
 		} /* switch ((op >> 21) & 0x1F) for the Coprocessor 0 prefix */
-		break;
 	case 17: /* Coprocessor 1 prefix */
 		switch ((op >> 21) & 0x1F) {
 		case 0: /* Coprocessor 1 opcode 0: MFC1 */
-			if (RT_OF(op) != 0) MFC1(r4300, op);
-			else                NOP(r4300, 0);
-			break;
+			if (RT_OF(op) != 0) return MFC1;
+			else                return NOP;
 		case 1: /* Coprocessor 1 opcode 1: DMFC1 */
-			if (RT_OF(op) != 0) DMFC1(r4300, op);
-			else                NOP(r4300, 0);
-			break;
+			if (RT_OF(op) != 0) return DMFC1;
+			else                return NOP;
 		case 2: /* Coprocessor 1 opcode 2: CFC1 */
-			if (RT_OF(op) != 0) CFC1(r4300, op);
-			else                NOP(r4300, 0);
-			break;
+			if (RT_OF(op) != 0) return CFC1;
+			else                return NOP;
 		case 3: /* Coprocessor 1 opcode 2: DCFC1  */
-			if (RT_OF(op) != 0) DCFC1(r4300, op);
-			else                NOP(r4300, 0);
-			break;
-		case 4: MTC1(r4300, op); break;
-		case 5: DMTC1(r4300, op); break;
-		case 6: CTC1(r4300, op); break;
-		case 7: DCTC1(r4300, op); break;
+			if (RT_OF(op) != 0) return DCFC1;
+			else                return NOP;
+		case 4: return MTC1;
+		case 5: return DMTC1;
+		case 6: return CTC1;
+		case 7: return DCTC1;
 		case 8: /* Coprocessor 1 opcode 8: Branch on C1 condition... */
 			switch ((op >> 16) & 0x3) {
 			case 0: /* opcode 0: BC1F */
-				if (IS_RELATIVE_IDLE_LOOP(r4300, op, *r4300_pc(r4300))) BC1F_IDLE(r4300, op);
-				else                                             BC1F(r4300, op);
-				break;
+				if (IS_RELATIVE_IDLE_LOOP(r4300, op, pc)) return BC1F_IDLE;
+				else                                      return BC1F;
 			case 1: /* opcode 1: BC1T */
-				if (IS_RELATIVE_IDLE_LOOP(r4300, op, *r4300_pc(r4300))) BC1T_IDLE(r4300, op);
-				else                                             BC1T(r4300, op);
-				break;
+				if (IS_RELATIVE_IDLE_LOOP(r4300, op, pc)) return BC1T_IDLE;
+				else                                      return BC1T;
 			case 2: /* opcode 2: BC1FL */
-				if (IS_RELATIVE_IDLE_LOOP(r4300, op, *r4300_pc(r4300))) BC1FL_IDLE(r4300, op);
-				else                                             BC1FL(r4300, op);
-				break;
-			case 3: /* opcode 3: BC1TL */
-				if (IS_RELATIVE_IDLE_LOOP(r4300, op, *r4300_pc(r4300))) BC1TL_IDLE(r4300, op);
-				else                                             BC1TL(r4300, op);
-				break;
+				if (IS_RELATIVE_IDLE_LOOP(r4300, op, pc)) return BC1FL_IDLE;
+				else                                      return BC1FL;
+			default: /* opcode 3: BC1TL */
+				if (IS_RELATIVE_IDLE_LOOP(r4300, op, pc)) return BC1TL_IDLE;
+				else                                      return BC1TL;
 			} /* switch ((op >> 16) & 0x3) for branches on C1 condition */
-			break;
 		case 16: /* Coprocessor 1 S-format opcodes */
 			switch (op & 0x3F) {
-			case 0: ADD_S(r4300, op); break;
-			case 1: SUB_S(r4300, op); break;
-			case 2: MUL_S(r4300, op); break;
-			case 3: DIV_S(r4300, op); break;
-			case 4: SQRT_S(r4300, op); break;
-			case 5: ABS_S(r4300, op); break;
-			case 6: MOV_S(r4300, op); break;
-			case 7: NEG_S(r4300, op); break;
-			case 8: ROUND_L_S(r4300, op); break;
-			case 9: TRUNC_L_S(r4300, op); break;
-			case 10: CEIL_L_S(r4300, op); break;
-			case 11: FLOOR_L_S(r4300, op); break;
-			case 12: ROUND_W_S(r4300, op); break;
-			case 13: TRUNC_W_S(r4300, op); break;
-			case 14: CEIL_W_S(r4300, op); break;
-			case 15: FLOOR_W_S(r4300, op); break;
-			case 33: CVT_D_S(r4300, op); break;
-			case 36: CVT_W_S(r4300, op); break;
-			case 37: CVT_L_S(r4300, op); break;
-			case 48: C_F_S(r4300, op); break;
-			case 49: C_UN_S(r4300, op); break;
-			case 50: C_EQ_S(r4300, op); break;
-			case 51: C_UEQ_S(r4300, op); break;
-			case 52: C_OLT_S(r4300, op); break;
-			case 53: C_ULT_S(r4300, op); break;
-			case 54: C_OLE_S(r4300, op); break;
-			case 55: C_ULE_S(r4300, op); break;
-			case 56: C_SF_S(r4300, op); break;
-			case 57: C_NGLE_S(r4300, op); break;
-			case 58: C_SEQ_S(r4300, op); break;
-			case 59: C_NGL_S(r4300, op); break;
-			case 60: C_LT_S(r4300, op); break;
-			case 61: C_NGE_S(r4300, op); break;
-			case 62: C_LE_S(r4300, op); break;
-			case 63: C_NGT_S(r4300, op); break;
+			case 0: return ADD_S;
+			case 1: return SUB_S;
+			case 2: return MUL_S;
+			case 3: return DIV_S;
+			case 4: return SQRT_S;
+			case 5: return ABS_S;
+			case 6: return MOV_S;
+			case 7: return NEG_S;
+			case 8: return ROUND_L_S;
+			case 9: return TRUNC_L_S;
+			case 10: return CEIL_L_S;
+			case 11: return FLOOR_L_S;
+			case 12: return ROUND_W_S;
+			case 13: return TRUNC_W_S;
+			case 14: return CEIL_W_S;
+			case 15: return FLOOR_W_S;
+			case 33: return CVT_D_S;
+			case 36: return CVT_W_S;
+			case 37: return CVT_L_S;
+			case 48: return C_F_S;
+			case 49: return C_UN_S;
+			case 50: return C_EQ_S;
+			case 51: return C_UEQ_S;
+			case 52: return C_OLT_S;
+			case 53: return C_ULT_S;
+			case 54: return C_OLE_S;
+			case 55: return C_ULE_S;
+			case 56: return C_SF_S;
+			case 57: return C_NGLE_S;
+			case 58: return C_SEQ_S;
+			case 59: return C_NGL_S;
+			case 60: return C_LT_S;
+			case 61: return C_NGE_S;
+			case 62: return C_LE_S;
+			case 63: return C_NGT_S;
 			default: /* Coprocessor 1 S-format opcodes 16..32, 34..35, 38..47:
 			            Reserved Instructions */
-				RESERVED(r4300, op);
-				break;
+				return RESERVED;
 			} /* switch (op & 0x3F) for Coprocessor 1 S-format opcodes */
-			break;
 		case 17: /* Coprocessor 1 D-format opcodes */
 			switch (op & 0x3F) {
-			case 0: ADD_D(r4300, op); break;
-			case 1: SUB_D(r4300, op); break;
-			case 2: MUL_D(r4300, op); break;
-			case 3: DIV_D(r4300, op); break;
-			case 4: SQRT_D(r4300, op); break;
-			case 5: ABS_D(r4300, op); break;
-			case 6: MOV_D(r4300, op); break;
-			case 7: NEG_D(r4300, op); break;
-			case 8: ROUND_L_D(r4300, op); break;
-			case 9: TRUNC_L_D(r4300, op); break;
-			case 10: CEIL_L_D(r4300, op); break;
-			case 11: FLOOR_L_D(r4300, op); break;
-			case 12: ROUND_W_D(r4300, op); break;
-			case 13: TRUNC_W_D(r4300, op); break;
-			case 14: CEIL_W_D(r4300, op); break;
-			case 15: FLOOR_W_D(r4300, op); break;
-			case 32: CVT_S_D(r4300, op); break;
-			case 36: CVT_W_D(r4300, op); break;
-			case 37: CVT_L_D(r4300, op); break;
-			case 48: C_F_D(r4300, op); break;
-			case 49: C_UN_D(r4300, op); break;
-			case 50: C_EQ_D(r4300, op); break;
-			case 51: C_UEQ_D(r4300, op); break;
-			case 52: C_OLT_D(r4300, op); break;
-			case 53: C_ULT_D(r4300, op); break;
-			case 54: C_OLE_D(r4300, op); break;
-			case 55: C_ULE_D(r4300, op); break;
-			case 56: C_SF_D(r4300, op); break;
-			case 57: C_NGLE_D(r4300, op); break;
-			case 58: C_SEQ_D(r4300, op); break;
-			case 59: C_NGL_D(r4300, op); break;
-			case 60: C_LT_D(r4300, op); break;
-			case 61: C_NGE_D(r4300, op); break;
-			case 62: C_LE_D(r4300, op); break;
-			case 63: C_NGT_D(r4300, op); break;
+			case 0: return ADD_D;
+			case 1: return SUB_D;
+			case 2: return MUL_D;
+			case 3: return DIV_D;
+			case 4: return SQRT_D;
+			case 5: return ABS_D;
+			case 6: return MOV_D;
+			case 7: return NEG_D;
+			case 8: return ROUND_L_D;
+			case 9: return TRUNC_L_D;
+			case 10: return CEIL_L_D;
+			case 11: return FLOOR_L_D;
+			case 12: return ROUND_W_D;
+			case 13: return TRUNC_W_D;
+			case 14: return CEIL_W_D;
+			case 15: return FLOOR_W_D;
+			case 32: return CVT_S_D;
+			case 36: return CVT_W_D;
+			case 37: return CVT_L_D;
+			case 48: return C_F_D;
+			case 49: return C_UN_D;
+			case 50: return C_EQ_D;
+			case 51: return C_UEQ_D;
+			case 52: return C_OLT_D;
+			case 53: return C_ULT_D;
+			case 54: return C_OLE_D;
+			case 55: return C_ULE_D;
+			case 56: return C_SF_D;
+			case 57: return C_NGLE_D;
+			case 58: return C_SEQ_D;
+			case 59: return C_NGL_D;
+			case 60: return C_LT_D;
+			case 61: return C_NGE_D;
+			case 62: return C_LE_D;
+			case 63: return C_NGT_D;
 			default: /* Coprocessor 1 D-format opcodes 16..31, 33..35, 38..47:
 			            Reserved Instructions */
-				RESERVED(r4300, op);
-				break;
+				return RESERVED;
 			} /* switch (op & 0x3F) for Coprocessor 1 D-format opcodes */
-			break;
 		case 20: /* Coprocessor 1 W-format opcodes */
 			switch (op & 0x3F) {
-			case 32: CVT_S_W(r4300, op); break;
-			case 33: CVT_D_W(r4300, op); break;
+			case 32: return CVT_S_W;
+			case 33: return CVT_D_W;
 			default: /* Coprocessor 1 W-format opcodes 0..31, 34..63:
 			            Reserved Instructions */
-				RESERVED(r4300, op);
-				break;
+				return RESERVED;
 			}
-			break;
 		case 21: /* Coprocessor 1 L-format opcodes */
 			switch (op & 0x3F) {
-			case 32: CVT_S_L(r4300, op); break;
-			case 33: CVT_D_L(r4300, op); break;
+			case 32: return CVT_S_L;
+			case 33: return CVT_D_L;
 			default: /* Coprocessor 1 L-format opcodes 0..31, 34..63:
 			            Reserved Instructions */
-				RESERVED(r4300, op);
-				break;
+				return RESERVED;
 			}
-			break;
 		default: /* Coprocessor 1 opcodes 9..15, 18..19, 22..31:
 		            Reserved Instructions */
-			RESERVED(r4300, op);
-			break;
+			return RESERVED;
 		} /* switch ((op >> 21) & 0x1F) for the Coprocessor 1 prefix */
-		break;
 	case 18: /* Coprocessor 2 prefix */
 		switch ((op >> 21) & 0x1F) {
 		case 0: /* Coprocessor 2 opcode 0: MFC2 */
-			if (RT_OF(op) != 0) MFC2(r4300, op);
-			else                NOP(r4300, 0);
-			break;
+			if (RT_OF(op) != 0) return MFC2;
+			else                return NOP;
 		case 1: /* Coprocessor 2 opcode 1: DMFC2 */
-			if (RT_OF(op) != 0) DMFC2(r4300, op);
-			else                NOP(r4300, 0);
-			break;
+			if (RT_OF(op) != 0) return DMFC2;
+			else                return NOP;
 		case 2: /* Coprocessor 2 opcode 2: CFC2 */
-			if (RT_OF(op) != 0) CFC2(r4300, op);
-			else                NOP(r4300, 0);
-			break;
-		case 4: MTC2(r4300, op); break;
-		case 5: DMTC2(r4300, op); break;
-		case 6: CTC2(r4300, op); break;
+			if (RT_OF(op) != 0) return CFC2;
+			else                return NOP;
+		case 4: return MTC2;
+		case 5: return DMTC2;
+		case 6: return CTC2;
 		default:
-			RESERVED_COP2(r4300, op);
-			break;
+			return RESERVED_COP2;
 		}
-		break;
 	case 20: /* Major opcode 20: BEQL */
-		if (IS_RELATIVE_IDLE_LOOP(r4300, op, *r4300_pc(r4300))) BEQL_IDLE(r4300, op);
-		else                                             BEQL(r4300, op);
-		break;
+		if (IS_RELATIVE_IDLE_LOOP(r4300, op, pc)) return BEQL_IDLE;
+		else                                      return BEQL;
 	case 21: /* Major opcode 21: BNEL */
-		if (IS_RELATIVE_IDLE_LOOP(r4300, op, *r4300_pc(r4300))) BNEL_IDLE(r4300, op);
-		else                                             BNEL(r4300, op);
-		break;
+		if (IS_RELATIVE_IDLE_LOOP(r4300, op, pc)) return BNEL_IDLE;
+		else                                      return BNEL;
 	case 22: /* Major opcode 22: BLEZL */
-		if (IS_RELATIVE_IDLE_LOOP(r4300, op, *r4300_pc(r4300))) BLEZL_IDLE(r4300, op);
-		else                                             BLEZL(r4300, op);
-		break;
+		if (IS_RELATIVE_IDLE_LOOP(r4300, op, pc)) return BLEZL_IDLE;
+		else                                      return BLEZL;
 	case 23: /* Major opcode 23: BGTZL */
-		if (IS_RELATIVE_IDLE_LOOP(r4300, op, *r4300_pc(r4300))) BGTZL_IDLE(r4300, op);
-		else                                             BGTZL(r4300, op);
-		break;
+		if (IS_RELATIVE_IDLE_LOOP(r4300, op, pc)) return BGTZL_IDLE;
+		else                                      return BGTZL;
 	case 24: /* Major opcode 24: DADDI */
-		if (RT_OF(op) != 0) DADDI(r4300, op);
-		else                NOP(r4300, 0);
-		break;
+		if (RT_OF(op) != 0) return DADDI;
+		else                return NOP;
 	case 25: /* Major opcode 25: DADDIU */
-		if (RT_OF(op) != 0) DADDIU(r4300, op);
-		else                NOP(r4300, 0);
-		break;
+		if (RT_OF(op) != 0) return DADDIU;
+		else                return NOP;
 	case 26: /* Major opcode 26: LDL */
-		if (RT_OF(op) != 0) LDL(r4300, op);
-		else                NOP(r4300, 0);
-		break;
+		if (RT_OF(op) != 0) return LDL;
+		else                return NOP;
 	case 27: /* Major opcode 27: LDR */
-		if (RT_OF(op) != 0) LDR(r4300, op);
-		else                NOP(r4300, 0);
-		break;
+		if (RT_OF(op) != 0) return LDR;
+		else                return NOP;
 	case 32: /* Major opcode 32: LB */
-		if (RT_OF(op) != 0) LB(r4300, op);
-		else                NOP(r4300, 0);
-		break;
+		if (RT_OF(op) != 0) return LB;
+		else                return NOP;
 	case 33: /* Major opcode 33: LH */
-		if (RT_OF(op) != 0) LH(r4300, op);
-		else                NOP(r4300, 0);
-		break;
+		if (RT_OF(op) != 0) return LH;
+		else                return NOP;
 	case 34: /* Major opcode 34: LWL */
-		if (RT_OF(op) != 0) LWL(r4300, op);
-		else                NOP(r4300, 0);
-		break;
+		if (RT_OF(op) != 0) return LWL;
+		else                return NOP;
 	case 35: /* Major opcode 35: LW */
-		if (RT_OF(op) != 0) LW(r4300, op);
-		else                NOP(r4300, 0);
-		break;
+		if (RT_OF(op) != 0) return LW;
+		else                return NOP;
 	case 36: /* Major opcode 36: LBU */
-		if (RT_OF(op) != 0) LBU(r4300, op);
-		else                NOP(r4300, 0);
-		break;
+		if (RT_OF(op) != 0) return LBU;
+		else                return NOP;
 	case 37: /* Major opcode 37: LHU */
-		if (RT_OF(op) != 0) LHU(r4300, op);
-		else                NOP(r4300, 0);
-		break;
+		if (RT_OF(op) != 0) return LHU;
+		else                return NOP;
 	case 38: /* Major opcode 38: LWR */
-		if (RT_OF(op) != 0) LWR(r4300, op);
-		else                NOP(r4300, 0);
-		break;
+		if (RT_OF(op) != 0) return LWR;
+		else                return NOP;
 	case 39: /* Major opcode 39: LWU */
-		if (RT_OF(op) != 0) LWU(r4300, op);
-		else                NOP(r4300, 0);
-		break;
-	case 40: SB(r4300, op); break;
-	case 41: SH(r4300, op); break;
-	case 42: SWL(r4300, op); break;
-	case 43: SW(r4300, op); break;
-	case 44: SDL(r4300, op); break;
-	case 45: SDR(r4300, op); break;
-	case 46: SWR(r4300, op); break;
-	case 47: CACHE(r4300, op); break;
+		if (RT_OF(op) != 0) return LWU;
+		else                return NOP;
+	case 40: return SB;
+	case 41: return SH;
+	case 42: return SWL;
+	case 43: return SW;
+	case 44: return SDL;
+	case 45: return SDR;
+	case 46: return SWR;
+	case 47: return CACHE;
 	case 48: /* Major opcode 48: LL */
-		if (RT_OF(op) != 0) LL(r4300, op);
-		else                NOP(r4300, 0);
-		break;
-	case 49: LWC1(r4300, op); break;
+		if (RT_OF(op) != 0) return LL;
+		else                return NOP;
+	case 49: return LWC1;
 	case 52: /* Major opcode 52: LLD (Not implemented) */
-		NI(r4300, op);
-		break;
-	case 53: LDC1(r4300, op); break;
+		return NI;
+	case 53: return LDC1;
 	case 55: /* Major opcode 55: LD */
-		if (RT_OF(op) != 0) LD(r4300, op);
-		else                NOP(r4300, 0);
-		break;
+		if (RT_OF(op) != 0) return LD;
+		else                return NOP;
 	case 56: /* Major opcode 56: SC */
-		if (RT_OF(op) != 0) SC(r4300, op);
-		else                NOP(r4300, 0);
-		break;
-	case 57: SWC1(r4300, op); break;
+		if (RT_OF(op) != 0) return SC;
+		else                return NOP;
+	case 57: return SWC1;
 	case 60: /* Major opcode 60: SCD (Not implemented) */
-		NI(r4300, op);
-		break;
-	case 61: SDC1(r4300, op); break;
-	case 63: SD(r4300, op); break;
+		return NI;
+	case 61: return SDC1;
+	case 63: return SD;
 	default: /* Major opcodes 18..19, 28..31, 50..51, 54, 58..59, 62:
 	            Reserved Instructions */
-		RESERVED(r4300, op);
-		break;
+		return RESERVED;
 	} /* switch ((op >> 26) & 0x3F) */
 }
 
+/* Returns the decoded instruction at physical address (in RDRAM),
+ * or NULL if it can't be kept. Entries are shared by every alias of
+ * the address, so they are decoded as if executed from KSEG0. */
+static struct pure_interp_entry* predecoded_entry(struct r4300_core* r4300, uint32_t address)
+{
+	struct pure_interp_page** page = &r4300->pure_interp.pages[address >> 12];
+	struct pure_interp_entry* entry;
+
+	if (*page == NULL) {
+		*page = calloc(1, sizeof(**page));
+		if (*page == NULL)
+			return NULL;
+	}
+
+	entry = &(*page)->entries[(address & 0xfff) >> 2];
+	if (entry->handler == NULL) {
+		/* Branches are decoded according to their delay slot.
+		 * Invalidations can't tell which page follows the last word of
+		 * a TLB mapped page, so that word is never kept. */
+		if ((address & 0xffc) == 0xffc)
+			return NULL;
+
+		entry->op = *mem_base_u32(r4300->mem->base, address);
+		entry->handler = decode_opcode(r4300, entry->op, UINT32_C(0x80000000) | address);
+	}
+
+	return entry;
+}
+
+static void free_predecoded_pages(struct pure_interp* interp)
+{
+	size_t i;
+
+	for (i = 0; i < sizeof(interp->pages) / sizeof(interp->pages[0]); ++i) {
+		free(interp->pages[i]);
+		interp->pages[i] = NULL;
+	}
+}
+
+void InterpretOpcode(struct r4300_core* r4300)
+{
+	uint32_t address = *r4300_pc(r4300);
+	uint32_t op;
+	int mapped = (address & UINT32_C(0xc0000000)) != UINT32_C(0x80000000);
+
+	if (mapped) {
+		address = virtual_to_physical_address(r4300, address, 2);
+		if (address == 0) // TLB exception
+			return;
+	}
+
+	address &= UINT32_C(0x1ffffffc);
+
+	if (r4300->pure_interp.threaded
+#ifdef DBG
+	    && !g_DebuggerActive
+#endif
+	    && address < r4300->rdram->dram_size) {
+		struct pure_interp_entry* entry = predecoded_entry(r4300, address);
+		/* whether J and JAL are idle loops depends on the virtual address */
+		if (entry != NULL && !(mapped && (entry->op >> 27) == 1)) {
+			entry->handler(r4300, entry->op);
+			return;
+		}
+	}
+
+	op = *mem_base_u32(r4300->mem->base, address);
+	decode_opcode(r4300, op, *r4300_pc(r4300))(r4300, op);
+}
+
+void invalidate_pure_interp_code(struct r4300_core* r4300, uint32_t address, size_t size)
+{
+	struct pure_interp* interp = &r4300->pure_interp;
+	uint32_t begin, end, i;
+
+	if (size == 0) {
+		free_predecoded_pages(interp);
+		return;
+	}
+
+	/* Pages are indexed by physical address. TLB mapped writes
+	 * also invalidate their KSEG0 and KSEG1 addresses. */
+	if ((address & UINT32_C(0xc0000000)) != UINT32_C(0x80000000))
+		return;
+
+	begin = address & UINT32_C(0x1ffffffc);
+	if (begin >= RDRAM_MAX_SIZE)
+		return;
+	end = (address & UINT32_C(0x1fffffff)) + size;
+	if (end > RDRAM_MAX_SIZE)
+		end = RDRAM_MAX_SIZE;
+
+	/* the branch before the range may have its delay slot in it */
+	if (begin > 0)
+		begin -= 4;
+
+	for (i = begin; i < end; i += 4) {
+		struct pure_interp_page* page = interp->pages[i >> 12];
+		if (page == NULL) {
+			i |= 0xffc;
+			continue;
+		}
+		page->entries[(i & 0xfff) >> 2].handler = NULL;
+	}
+}
+
 void run_pure_interpreter(struct r4300_core* r4300)
 {
    *r4300_stop(r4300) = 0;
    *r4300_pc_struct(r4300) = &r4300->interp_PC;
    *r4300_pc(r4300) = r4300->cp0.last_addr = r4300->start_address;
+   free_predecoded_pages(&r4300->pure_interp);
 
    while (!*r4300_stop(r4300))
    {
@@ -768,4 +775,6 @@ void run_pure_interpreter(struct r4300_core* r4300)
 #endif
      InterpretOpcode(r4300);
    }
+
+   free_predecoded_pages(&r4300->pure_interp);
 }
@@ -22,8 +22,13 @@
 #ifndef M64P_DEVICE_R4300_PURE_INTERP_H
 #define M64P_DEVICE_R4300_PURE_INTERP_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 struct r4300_core;
 
 void run_pure_interpreter(struct r4300_core* r4300);
 
+void invalidate_pure_interp_code(struct r4300_core* r4300, uint32_t address, size_t size);
+
 #endif /* M64P_DEVICE_R4300_PURE_INTERP_H */
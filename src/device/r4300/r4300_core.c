@@ -41,7 +41,8 @@
 #include <time.h>
 
 void init_r4300(struct r4300_core* r4300, struct memory* mem, struct mi_controller* mi, struct rdram* rdram, const struct interrupt_handler* interrupt_handlers,
-    unsigned int emumode, unsigned int count_per_op, unsigned int count_per_op_denom_pot, int no_compiled_jump, int randomize_interrupt, uint32_t start_address)
+    unsigned int emumode, unsigned int count_per_op, unsigned int count_per_op_denom_pot, int no_compiled_jump, int randomize_interrupt, uint32_t start_address, const char* block_cache_path,
+    unsigned int new_dynarec_cache_size, unsigned int new_dynarec_cache_size_max, int pure_interp_threaded)
 {
     struct new_dynarec_hot_state* new_dynarec_hot_state =
 #ifdef NEW_DYNAREC
@@ -57,7 +58,12 @@ void init_r4300(struct r4300_core* r4300, struct memory* mem, struct mi_controll
 
 #ifndef NEW_DYNAREC
     r4300->recomp.no_compiled_jump = no_compiled_jump;
+#else
+    r4300->block_cache_path = block_cache_path;
+    r4300->new_dynarec_cache_size = new_dynarec_cache_size;
+    r4300->new_dynarec_cache_size_max = new_dynarec_cache_size_max;
 #endif
+    r4300->pure_interp.threaded = pure_interp_threaded;
 
     r4300->mem = mem;
     r4300->mi = mi;
@@ -420,6 +426,10 @@ void invalidate_r4300_cached_code(struct r4300_core* r4300, uint32_t address, si
             invalidate_cached_code_hacktarux(r4300, address, size);
         }
     }
+    else
+    {
+        invalidate_pure_interp_code(r4300, address, size);
+    }
 }
 
 
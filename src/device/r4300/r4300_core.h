@@ -44,12 +44,53 @@ struct mi_controller;
 struct rdram;
 
 struct jump_table;
+struct cached_interp_slab;
+struct pure_interp_page;
+
+/* The dynarecs test invalid_code bytes from the code they generate, and
+ * the old dynarec also indexes blocks, so these tables only get their
+ * compact layouts when it doesn't matter. */
+#if !defined(DYNAREC)
+#define CACHED_INTERP_INVALID_CODE_BITMAP
+#endif
+#if !defined(DYNAREC) || defined(NEW_DYNAREC)
+#define CACHED_INTERP_BLOCKS_TWO_LEVEL
+#endif
+
 struct cached_interp
 {
+#if defined(CACHED_INTERP_INVALID_CODE_BITMAP)
+    uint32_t invalid_code[0x100000 / 32];
+#else
     char invalid_code[0x100000];
+#endif
+#if defined(CACHED_INTERP_BLOCKS_TWO_LEVEL)
+    /* tables of 0x400 blocks, allocated on demand */
+    struct precomp_block** blocks[0x400];
+#else
     struct precomp_block* blocks[0x100000];
+#endif
     struct precomp_block* actual;
 
+    /* slab arena of the block instructions (cached interpreter only) */
+    struct cached_interp_slab* slabs;
+    size_t slab_free;                       /* arrays left in the first slab */
+
+    /* hot path traces (cached interpreter only) */
+    int trace_enabled;
+    struct cached_interp_trace* trace;      /* trace being run, if any */
+
+    /* fused instruction pairs statistics (cached interpreter only) */
+    unsigned int fused_pairs;
+#ifdef DBG
+    uint64_t fusion_hits;
+#endif
+
+    /* idle loops statistics (cached interpreter only) */
+    unsigned int idle_loops;
+    uint64_t idle_loop_skips;
+    uint64_t idle_loop_cycles;
+
     void (*fin_block)(void);
     void (*not_compiled)(void);
     void (*not_compiled2)(void);
@@ -61,6 +102,38 @@ struct cached_interp
         const uint32_t* source, struct precomp_block* block, uint32_t func);
 };
 
+/* page is an address >> 12 */
+static osal_inline int cached_interp_invalid_code(const struct cached_interp* cinterp, uint32_t page)
+{
+#if defined(CACHED_INTERP_INVALID_CODE_BITMAP)
+    return (cinterp->invalid_code[page >> 5] >> (page & 31)) & 1;
+#else
+    return cinterp->invalid_code[page];
+#endif
+}
+
+static osal_inline void cached_interp_set_invalid_code(struct cached_interp* cinterp, uint32_t page, int invalid)
+{
+#if defined(CACHED_INTERP_INVALID_CODE_BITMAP)
+    if (invalid)
+        cinterp->invalid_code[page >> 5] |= UINT32_C(1) << (page & 31);
+    else
+        cinterp->invalid_code[page >> 5] &= ~(UINT32_C(1) << (page & 31));
+#else
+    cinterp->invalid_code[page] = (char)invalid;
+#endif
+}
+
+static osal_inline struct precomp_block* cached_interp_get_block(const struct cached_interp* cinterp, uint32_t address)
+{
+#if defined(CACHED_INTERP_BLOCKS_TWO_LEVEL)
+    struct precomp_block** const table = cinterp->blocks[address >> 22];
+    return (table != NULL) ? table[(address >> 12) & 0x3ff] : NULL;
+#else
+    return cinterp->blocks[address >> 12];
+#endif
+}
+
 enum {
     EMUMODE_PURE_INTERPRETER = 0,
     EMUMODE_INTERPRETER      = 1,
@@ -68,6 +141,12 @@ enum {
 };
 
 
+struct pure_interp
+{
+    int threaded;                               /* dispatch predecoded instructions of RDRAM */
+    struct pure_interp_page* pages[0x800];      /* predecoded 4KB pages of RDRAM, allocated on demand */
+};
+
 struct r4300_core
 {
 #ifndef NEW_DYNAREC
@@ -93,6 +172,7 @@ struct r4300_core
 
     /* from pure_interp.c */
     struct precomp_instr interp_PC;
+    struct pure_interp pure_interp;
 
     /* from cached_interp.c.
      * XXX: more work is needed to correctly encapsulate these */
@@ -178,12 +258,11 @@ struct r4300_core
         uint64_t wdword;
     } recomp;
 #else
-    /* FIXME: better put that near linkage_arm code
-     * to help generate call beyond the +/-32MB range.
-     */
-    ALIGN(4096, unsigned char extra_memory_buffer[NEW_DYNAREC_CACHE_SIZE + NEW_DYNAREC_CACHE_PAGE_PAD]);
-    unsigned char* extra_memory;
+    unsigned char* extra_memory;                        /* code cache, see new_dynarec.c */
     struct new_dynarec_hot_state new_dynarec_hot_state;
+    const char* block_cache_path;                       /* per-ROM list of compiled blocks, NULL if disabled */
+    unsigned int new_dynarec_cache_size;                /* initial code cache size in MB */
+    unsigned int new_dynarec_cache_size_max;            /* size in MB the code cache may grow to */
 #endif /* NEW_DYNAREC */
 
     unsigned int emumode;
@@ -215,7 +294,7 @@ struct r4300_core
     offsetof(struct new_dynarec_hot_state, regs))
 #endif
 
-void init_r4300(struct r4300_core* r4300, struct memory* mem, struct mi_controller* mi, struct rdram* rdram, const struct interrupt_handler* interrupt_handlers, unsigned int emumode, unsigned int count_per_op, unsigned int count_per_op_denom_pot, int no_compiled_jump, int randomize_interrupt, uint32_t start_address);
+void init_r4300(struct r4300_core* r4300, struct memory* mem, struct mi_controller* mi, struct rdram* rdram, const struct interrupt_handler* interrupt_handlers, unsigned int emumode, unsigned int count_per_op, unsigned int count_per_op_denom_pot, int no_compiled_jump, int randomize_interrupt, uint32_t start_address, const char* block_cache_path, unsigned int new_dynarec_cache_size, unsigned int new_dynarec_cache_size_max, int pure_interp_threaded);
 void poweron_r4300(struct r4300_core* r4300);
 
 void run_r4300(struct r4300_core* r4300);
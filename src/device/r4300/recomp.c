@@ -40,6 +40,7 @@
 #include "device/r4300/cached_interp.h"
 #include "device/r4300/cp0.h"
 #include "device/r4300/idec.h"
+#include "device/r4300/perf_map.h"
 #include "device/r4300/recomp_types.h"
 #include "device/r4300/tlb.h"
 #include "main/main.h"
@@ -459,7 +460,7 @@ void dynarec_init_block(struct r4300_core* r4300, uint32_t address)
     timed_section_start(TIMED_SECTION_COMPILER);
 #endif
 
-    struct precomp_block** block = &r4300->cached_interp.blocks[address >> 12];
+    struct precomp_block** block = cached_interp_block_slot(&r4300->cached_interp, address);
 
     /* allocate block */
     if (*block == NULL) {
@@ -470,6 +471,9 @@ void dynarec_init_block(struct r4300_core* r4300, uint32_t address)
         (*block)->code = NULL;
         (*block)->jumps_table = NULL;
         (*block)->riprel_table = NULL;
+        (*block)->hits = NULL;
+        (*block)->traces = NULL;
+        (*block)->idle_loops = NULL;
     }
 
     struct precomp_block* b = *block;
@@ -579,15 +583,15 @@ void dynarec_init_block(struct r4300_core* r4300, uint32_t address)
     /* here we're marking the block as a valid code even if it's not compiled
      * yet as the game should have already set up the code correctly.
      */
-    r4300->cached_interp.invalid_code[b->start>>12] = 0;
+    cached_interp_set_invalid_code(&r4300->cached_interp, b->start>>12, 0);
     if (b->end < UINT32_C(0x80000000) || b->start >= UINT32_C(0xc0000000))
     {
         uint32_t paddr = virtual_to_physical_address(r4300, b->start, 2);
-        r4300->cached_interp.invalid_code[paddr>>12] = 0;
+        cached_interp_set_invalid_code(&r4300->cached_interp, paddr>>12, 0);
         dynarec_init_block(r4300, paddr);
 
         paddr += b->end - b->start - 4;
-        r4300->cached_interp.invalid_code[paddr>>12] = 0;
+        cached_interp_set_invalid_code(&r4300->cached_interp, paddr>>12, 0);
         dynarec_init_block(r4300, paddr);
 
     }
@@ -595,7 +599,7 @@ void dynarec_init_block(struct r4300_core* r4300, uint32_t address)
     {
         uint32_t alt_addr = b->start ^ UINT32_C(0x20000000);
 
-        if (r4300->cached_interp.invalid_code[alt_addr>>12])
+        if (cached_interp_invalid_code(&r4300->cached_interp, alt_addr>>12))
         {
             dynarec_init_block(r4300, alt_addr);
         }
@@ -622,6 +626,8 @@ void dynarec_recompile_block(struct r4300_core* r4300, const uint32_t* iw, struc
 {
     int i, length, length2, finished;
     enum r4300_opcode opcode;
+    unsigned char* code = block->code;
+    size_t code_start = block->code_length;
 
     /* ??? not sure why we need these 2 different tests */
     int block_start_in_tlb = ((block->start & UINT32_C(0xc0000000)) != UINT32_C(0x80000000));
@@ -660,8 +666,9 @@ void dynarec_recompile_block(struct r4300_core* r4300, const uint32_t* iw, struc
         if (block_start_in_tlb)
         {
             uint32_t address2 = virtual_to_physical_address(r4300, r4300->recomp.dst->addr, 0);
-            if (r4300->cached_interp.blocks[address2>>12]->block[(address2&UINT32_C(0xFFF))/4].ops == r4300->cached_interp.not_compiled) {
-                r4300->cached_interp.blocks[address2>>12]->block[(address2&UINT32_C(0xFFF))/4].ops = r4300->cached_interp.not_compiled2;
+            struct precomp_instr* inst2 = &cached_interp_get_block(&r4300->cached_interp, address2)->block[(address2&UINT32_C(0xFFF))/4];
+            if (inst2->ops == r4300->cached_interp.not_compiled) {
+                inst2->ops = r4300->cached_interp.not_compiled2;
             }
         }
 
@@ -749,6 +756,11 @@ void dynarec_recompile_block(struct r4300_core* r4300, const uint32_t* iw, struc
     block->max_code_length = r4300->recomp.max_code_length;
     free_assembler(r4300, &block->jumps_table, &block->jumps_number, &block->riprel_table, &block->riprel_number);
 
+    if (block->code == code)
+        perf_map_add(block->code + code_start, block->code_length - code_start, func);
+    else /* the code was moved by realloc_exec(), describe all of it again */
+        perf_map_add(block->code, block->code_length, block->start);
+
 #ifdef DBG
     DebugMessage(M64MSG_INFO, "block recompiled (%" PRIX32 "-%" PRIX32 ")", func, block->start+i*4);
 #endif
@@ -31,6 +31,9 @@
 #include "x86/assemble_struct.h"
 #endif
 
+struct cached_interp_idle_loop;
+struct cached_interp_trace;
+
 struct precomp_instr
 {
     void (*ops)(void);
@@ -89,6 +92,11 @@ struct precomp_block
     void *riprel_table;
     int riprel_number;
     uint64_t xxhash;
+
+    /* these fields are cached interpreter specific */
+    unsigned char *hits;                    /* per entry execution counters */
+    struct cached_interp_trace **traces;    /* per entry hot path traces */
+    struct cached_interp_idle_loop **idle_loops; /* per entry idle loops ended there */
 };
 
 #endif /* M64P_DEVICE_R4300_RECOMP_TYPES_H */
@@ -28,12 +28,61 @@
 #include <assert.h>
 #include <string.h>
 
+static void flush_micro_tlb(struct tlb* tlb)
+{
+    size_t i;
+
+    for (i = 0; i < TLB_MICRO_ENTRIES; ++i) {
+        tlb->micro[i].page = TLB_MICRO_INVALID;
+    }
+}
+
+static void mark_mapped_regions(struct tlb* tlb, uint32_t start, uint32_t end)
+{
+    uint32_t region;
+
+    for (region = start >> 20; region <= (end >> 20); ++region) {
+        tlb->mapped_regions[region >> 5] |= UINT32_C(1) << (region & 0x1f);
+    }
+}
+
+/* clear the bits of the regions in [start, end] which no longer have any mapping */
+static void update_mapped_regions(struct tlb* tlb, uint32_t start, uint32_t end)
+{
+    uint32_t region;
+    size_t i;
+
+    for (region = start >> 20; region <= (end >> 20); ++region)
+    {
+        const uint32_t* lut_r = &tlb->LUT_r[region << 8];
+        const uint32_t* lut_w = &tlb->LUT_w[region << 8];
+        uint32_t used = 0;
+
+        for (i = 0; i < 0x100; ++i) {
+            used |= lut_r[i] | lut_w[i];
+        }
+
+        if (used == 0) {
+            tlb->mapped_regions[region >> 5] &= ~(UINT32_C(1) << (region & 0x1f));
+        }
+    }
+}
+
 void poweron_tlb(struct tlb* tlb)
 {
     /* clear TLB entries */
     memset(tlb->entries, 0, 32 * sizeof(tlb->entries[0]));
     memset(tlb->LUT_r, 0, 0x100000 * sizeof(tlb->LUT_r[0]));
     memset(tlb->LUT_w, 0, 0x100000 * sizeof(tlb->LUT_w[0]));
+    memset(tlb->mapped_regions, 0, sizeof(tlb->mapped_regions));
+    flush_micro_tlb(tlb);
+}
+
+void tlb_rebuild_lookup(struct tlb* tlb)
+{
+    memset(tlb->mapped_regions, 0xff, sizeof(tlb->mapped_regions));
+    update_mapped_regions(tlb, 0, UINT32_C(0xffffffff));
+    flush_micro_tlb(tlb);
 }
 
 void tlb_unmap(struct tlb* tlb, size_t entry)
@@ -44,22 +93,26 @@ void tlb_unmap(struct tlb* tlb, size_t entry)
     assert(entry < 32);
     e = &tlb->entries[entry];
 
-    if (e->v_even)
+    flush_micro_tlb(tlb);
+
+    if (e->v_even && e->start_even < e->end_even)
     {
         for (i=e->start_even; i<e->end_even; i += 0x1000)
             tlb->LUT_r[i>>12] = 0;
         if (e->d_even)
             for (i=e->start_even; i<e->end_even; i += 0x1000)
                 tlb->LUT_w[i>>12] = 0;
+        update_mapped_regions(tlb, e->start_even, e->end_even);
     }
 
-    if (e->v_odd)
+    if (e->v_odd && e->start_odd < e->end_odd)
     {
         for (i=e->start_odd; i<e->end_odd; i += 0x1000)
             tlb->LUT_r[i>>12] = 0;
         if (e->d_odd)
             for (i=e->start_odd; i<e->end_odd; i += 0x1000)
                 tlb->LUT_w[i>>12] = 0;
+        update_mapped_regions(tlb, e->start_odd, e->end_odd);
     }
 }
 
@@ -71,6 +124,8 @@ void tlb_map(struct tlb* tlb, size_t entry)
     assert(entry < 32);
     e = &tlb->entries[entry];
 
+    flush_micro_tlb(tlb);
+
     if (e->v_even)
     {
         if (e->start_even < e->end_even &&
@@ -82,6 +137,7 @@ void tlb_map(struct tlb* tlb, size_t entry)
             if (e->d_even)
                 for (i=e->start_even;i<e->end_even;i+=0x1000)
                     tlb->LUT_w[i>>12] = UINT32_C(0x80000000) | (e->phys_even + (i - e->start_even) + 0xFFF);
+            mark_mapped_regions(tlb, e->start_even, e->end_even);
         }
     }
 
@@ -96,14 +152,17 @@ void tlb_map(struct tlb* tlb, size_t entry)
             if (e->d_odd)
                 for (i=e->start_odd;i<e->end_odd;i+=0x1000)
                     tlb->LUT_w[i>>12] = UINT32_C(0x80000000) | (e->phys_odd + (i - e->start_odd) + 0xFFF);
+            mark_mapped_regions(tlb, e->start_odd, e->end_odd);
         }
     }
 }
 
 uint32_t virtual_to_physical_address(struct r4300_core* r4300, uint32_t address, int w)
 {
-    const struct tlb* tlb = &r4300->cp0.tlb;
+    struct tlb* tlb = &r4300->cp0.tlb;
     unsigned int addr = address >> 12;
+    struct tlb_micro_entry* micro = &tlb->micro[addr & (TLB_MICRO_ENTRIES - 1)];
+    uint32_t lut;
 
 #ifdef NEW_DYNAREC
     if (r4300->emumode == EMUMODE_DYNAREC)
@@ -127,16 +186,24 @@ uint32_t virtual_to_physical_address(struct r4300_core* r4300, uint32_t address,
     }
 #endif
 
-    if (w == 1)
-    {
-        if (tlb->LUT_w[addr])
-            return (tlb->LUT_w[addr] & UINT32_C(0xFFFFF000)) | (address & UINT32_C(0xFFF));
-    }
-    else
+    if (micro->page != addr)
     {
-        if (tlb->LUT_r[addr])
-            return (tlb->LUT_r[addr] & UINT32_C(0xFFFFF000)) | (address & UINT32_C(0xFFF));
+        micro->page = addr;
+        if (tlb->mapped_regions[addr >> 13] & (UINT32_C(1) << ((addr >> 8) & 0x1f)))
+        {
+            micro->r = tlb->LUT_r[addr];
+            micro->w = tlb->LUT_w[addr];
+        }
+        else
+        {
+            micro->r = 0;
+            micro->w = 0;
+        }
     }
+
+    lut = (w == 1) ? micro->w : micro->r;
+    if (lut)
+        return (lut & UINT32_C(0xFFFFF000)) | (address & UINT32_C(0xFFF));
     //printf("tlb exception !!! @ %x, %x, add:%x\n", address, w, r4300->pc->addr);
     //getchar();
 
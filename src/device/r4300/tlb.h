@@ -52,15 +52,37 @@ struct tlb_entry
    unsigned int phys_odd;
 };
 
+/* Number of entries of the direct-mapped micro-TLB (power of 2) */
+#define TLB_MICRO_ENTRIES 64
+#define TLB_MICRO_INVALID UINT32_C(0xffffffff)
+
+/* Copy of the LUT_r/LUT_w entries of a recently translated page */
+struct tlb_micro_entry
+{
+    uint32_t page;
+    uint32_t r;
+    uint32_t w;
+};
+
 struct tlb
 {
     struct tlb_entry entries[32];
     uint32_t LUT_r[0x100000];
     uint32_t LUT_w[0x100000];
+
+    /* One bit per 1MB region, set if any of its pages has a LUT_r or LUT_w
+     * entry. Lookups in unmapped regions don't have to touch the LUTs. */
+    uint32_t mapped_regions[0x1000 / 32];
+
+    struct tlb_micro_entry micro[TLB_MICRO_ENTRIES];
 };
 
 void poweron_tlb(struct tlb* tlb);
 
+/* Rebuild mapped_regions and flush the micro-TLB after LUT_r/LUT_w
+ * have been written directly (eg. by a state load). */
+void tlb_rebuild_lookup(struct tlb* tlb);
+
 void tlb_unmap(struct tlb* tlb, size_t entry);
 void tlb_map(struct tlb* tlb, size_t entry);
 
@@ -583,6 +583,14 @@ static osal_inline void mov_reg32_preg32pimm32(int reg1, int reg2, unsigned int
     put32(imm32);
 }
 
+static osal_inline void movzx_reg32_preg32pimm32(int reg1, int reg2, unsigned int imm32)
+{
+    put8(0x0F);
+    put8(0xB6);
+    put8(0x80 | (reg1 << 3) | reg2);
+    put32(imm32);
+}
+
 static osal_inline void lea_reg32_preg32x2preg32(int reg1, int reg2, int reg3)
 {
     put8(0x8D);
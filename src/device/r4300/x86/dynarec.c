@@ -276,8 +276,9 @@ void gen_LB(struct r4300_core* r4300)
 
         shr_reg32_imm8(EAX, 16);
         and_reg32_imm32(EAX, 0x1fff);
+        movzx_reg32_preg32pimm32(EAX, EAX, (unsigned int)r4300->mem->handler_index);
         lea_reg32_preg32x2preg32(EAX, EAX, EAX);
-        mov_reg32_preg32x4pimm32(EAX, EAX, (unsigned int)r4300->mem->handlers[0].read32);
+        mov_reg32_preg32x4pimm32(EAX, EAX, (unsigned int)&r4300->mem->handlers[0].read32);
         cmp_reg32_imm32(EAX, (unsigned int)read_rdram_dram);
 
         jump_end_rel8(r4300);
@@ -342,8 +343,9 @@ void gen_LBU(struct r4300_core* r4300)
 
         shr_reg32_imm8(EAX, 16);
         and_reg32_imm32(EAX, 0x1fff);
+        movzx_reg32_preg32pimm32(EAX, EAX, (unsigned int)r4300->mem->handler_index);
         lea_reg32_preg32x2preg32(EAX, EAX, EAX);
-        mov_reg32_preg32x4pimm32(EAX, EAX, (unsigned int)r4300->mem->handlers[0].read32);
+        mov_reg32_preg32x4pimm32(EAX, EAX, (unsigned int)&r4300->mem->handlers[0].read32);
         cmp_reg32_imm32(EAX, (unsigned int)read_rdram_dram);
 
         jump_end_rel8(r4300);
@@ -406,8 +408,9 @@ void gen_LH(struct r4300_core* r4300)
 
         shr_reg32_imm8(EAX, 16);
         and_reg32_imm32(EAX, 0x1fff);
+        movzx_reg32_preg32pimm32(EAX, EAX, (unsigned int)r4300->mem->handler_index);
         lea_reg32_preg32x2preg32(EAX, EAX, EAX);
-        mov_reg32_preg32x4pimm32(EAX, EAX, (unsigned int)r4300->mem->handlers[0].read32);
+        mov_reg32_preg32x4pimm32(EAX, EAX, (unsigned int)&r4300->mem->handlers[0].read32);
         cmp_reg32_imm32(EAX, (unsigned int)read_rdram_dram);
 
         jump_end_rel8(r4300);
@@ -472,8 +475,9 @@ void gen_LHU(struct r4300_core* r4300)
 
         shr_reg32_imm8(EAX, 16);
         and_reg32_imm32(EAX, 0x1fff);
+        movzx_reg32_preg32pimm32(EAX, EAX, (unsigned int)r4300->mem->handler_index);
         lea_reg32_preg32x2preg32(EAX, EAX, EAX);
-        mov_reg32_preg32x4pimm32(EAX, EAX, (unsigned int)r4300->mem->handlers[0].read32);
+        mov_reg32_preg32x4pimm32(EAX, EAX, (unsigned int)&r4300->mem->handlers[0].read32);
         cmp_reg32_imm32(EAX, (unsigned int)read_rdram_dram);
 
         jump_end_rel8(r4300);
@@ -541,8 +545,9 @@ void gen_LW(struct r4300_core* r4300)
 
         shr_reg32_imm8(EAX, 16);
         and_reg32_imm32(EAX, 0x1fff);
+        movzx_reg32_preg32pimm32(EAX, EAX, (unsigned int)r4300->mem->handler_index);
         lea_reg32_preg32x2preg32(EAX, EAX, EAX);
-        mov_reg32_preg32x4pimm32(EAX, EAX, (unsigned int)r4300->mem->handlers[0].read32);
+        mov_reg32_preg32x4pimm32(EAX, EAX, (unsigned int)&r4300->mem->handlers[0].read32);
         cmp_reg32_imm32(EAX, (unsigned int)read_rdram_dram);
 
         jump_end_rel8(r4300);
@@ -588,8 +593,9 @@ void gen_LWU(struct r4300_core* r4300)
 
         shr_reg32_imm8(EAX, 16);
         and_reg32_imm32(EAX, 0x1fff);
+        movzx_reg32_preg32pimm32(EAX, EAX, (unsigned int)r4300->mem->handler_index);
         lea_reg32_preg32x2preg32(EAX, EAX, EAX);
-        mov_reg32_preg32x4pimm32(EAX, EAX, (unsigned int)r4300->mem->handlers[0].read32);
+        mov_reg32_preg32x4pimm32(EAX, EAX, (unsigned int)&r4300->mem->handlers[0].read32);
         cmp_reg32_imm32(EAX, (unsigned int)read_rdram_dram);
 
         jump_end_rel8(r4300);
@@ -647,8 +653,9 @@ void gen_LD(struct r4300_core* r4300)
 
         shr_reg32_imm8(EAX, 16);
         and_reg32_imm32(EAX, 0x1fff);
+        movzx_reg32_preg32pimm32(EAX, EAX, (unsigned int)r4300->mem->handler_index);
         lea_reg32_preg32x2preg32(EAX, EAX, EAX);
-        mov_reg32_preg32x4pimm32(EAX, EAX, (unsigned int)r4300->mem->handlers[0].read32);
+        mov_reg32_preg32x4pimm32(EAX, EAX, (unsigned int)&r4300->mem->handlers[0].read32);
         cmp_reg32_imm32(EAX, (unsigned int)read_rdram_dram);
 
         jump_end_rel8(r4300);
@@ -713,8 +720,9 @@ void gen_SB(struct r4300_core* r4300)
 
         shr_reg32_imm8(EAX, 16);
         and_reg32_imm32(EAX, 0x1fff);
+        movzx_reg32_preg32pimm32(EAX, EAX, (unsigned int)r4300->mem->handler_index);
         lea_reg32_preg32x2preg32(EAX, EAX, EAX);
-        mov_reg32_preg32x4pimm32(EAX, EAX, (unsigned int)r4300->mem->handlers[0].write32);
+        mov_reg32_preg32x4pimm32(EAX, EAX, (unsigned int)&r4300->mem->handlers[0].write32);
         cmp_reg32_imm32(EAX, (unsigned int)write_rdram_dram);
 
         jump_end_rel8(r4300);
@@ -794,8 +802,9 @@ void gen_SH(struct r4300_core* r4300)
 
         shr_reg32_imm8(EAX, 16);
         and_reg32_imm32(EAX, 0x1fff);
+        movzx_reg32_preg32pimm32(EAX, EAX, (unsigned int)r4300->mem->handler_index);
         lea_reg32_preg32x2preg32(EAX, EAX, EAX);
-        mov_reg32_preg32x4pimm32(EAX, EAX, (unsigned int)r4300->mem->handlers[0].write32);
+        mov_reg32_preg32x4pimm32(EAX, EAX, (unsigned int)&r4300->mem->handlers[0].write32);
         cmp_reg32_imm32(EAX, (unsigned int)write_rdram_dram);
 
         jump_end_rel8(r4300);
@@ -875,8 +884,9 @@ void gen_SW(struct r4300_core* r4300)
 
         shr_reg32_imm8(EAX, 16);
         and_reg32_imm32(EAX, 0x1fff);
+        movzx_reg32_preg32pimm32(EAX, EAX, (unsigned int)r4300->mem->handler_index);
         lea_reg32_preg32x2preg32(EAX, EAX, EAX);
-        mov_reg32_preg32x4pimm32(EAX, EAX, (unsigned int)r4300->mem->handlers[0].write32);
+        mov_reg32_preg32x4pimm32(EAX, EAX, (unsigned int)&r4300->mem->handlers[0].write32);
         cmp_reg32_imm32(EAX, (unsigned int)write_rdram_dram);
 
         jump_end_rel8(r4300);
@@ -952,8 +962,9 @@ void gen_SD(struct r4300_core* r4300)
 
         shr_reg32_imm8(EAX, 16);
         and_reg32_imm32(EAX, 0x1fff);
+        movzx_reg32_preg32pimm32(EAX, EAX, (unsigned int)r4300->mem->handler_index);
         lea_reg32_preg32x2preg32(EAX, EAX, EAX);
-        mov_reg32_preg32x4pimm32(EAX, EAX, (unsigned int)r4300->mem->handlers[0].write32);
+        mov_reg32_preg32x4pimm32(EAX, EAX, (unsigned int)&r4300->mem->handlers[0].write32);
         cmp_reg32_imm32(EAX, (unsigned int)write_rdram_dram);
 
         jump_end_rel8(r4300);
@@ -4157,8 +4168,9 @@ void gen_LWC1(struct r4300_core* r4300)
     else
     {
         shr_reg32_imm8(EAX, 16);
+        movzx_reg32_preg32pimm32(EAX, EAX, (unsigned int)r4300->mem->handler_index);
         lea_reg32_preg32x2preg32(EAX, EAX, EAX);
-        mov_reg32_preg32x4pimm32(EAX, EAX, (unsigned int)r4300->mem->handlers[0].read32);
+        mov_reg32_preg32x4pimm32(EAX, EAX, (unsigned int)&r4300->mem->handlers[0].read32);
         cmp_reg32_imm32(EAX, (unsigned int)read_rdram_dram);
     }
     je_rj(37);
@@ -4196,8 +4208,9 @@ void gen_LDC1(struct r4300_core* r4300)
     else
     {
         shr_reg32_imm8(EAX, 16);
+        movzx_reg32_preg32pimm32(EAX, EAX, (unsigned int)r4300->mem->handler_index);
         lea_reg32_preg32x2preg32(EAX, EAX, EAX);
-        mov_reg32_preg32x4pimm32(EAX, EAX, (unsigned int)r4300->mem->handlers[0].read32);
+        mov_reg32_preg32x4pimm32(EAX, EAX, (unsigned int)&r4300->mem->handlers[0].read32);
         cmp_reg32_imm32(EAX, (unsigned int)read_rdram_dram);
     }
     je_rj(37);
@@ -4245,8 +4258,9 @@ void gen_SWC1(struct r4300_core* r4300)
 
         shr_reg32_imm8(EAX, 16);
         and_reg32_imm32(EAX, 0x1fff);
+        movzx_reg32_preg32pimm32(EAX, EAX, (unsigned int)r4300->mem->handler_index);
         lea_reg32_preg32x2preg32(EAX, EAX, EAX);
-        mov_reg32_preg32x4pimm32(EAX, EAX, (unsigned int)r4300->mem->handlers[0].write32);
+        mov_reg32_preg32x4pimm32(EAX, EAX, (unsigned int)&r4300->mem->handlers[0].write32);
         cmp_reg32_imm32(EAX, (unsigned int)write_rdram_dram);
 
         jump_end_rel8(r4300);
@@ -4312,8 +4326,9 @@ void gen_SDC1(struct r4300_core* r4300)
 
         shr_reg32_imm8(EAX, 16);
         and_reg32_imm32(EAX, 0x1fff);
+        movzx_reg32_preg32pimm32(EAX, EAX, (unsigned int)r4300->mem->handler_index);
         lea_reg32_preg32x2preg32(EAX, EAX, EAX);
-        mov_reg32_preg32x4pimm32(EAX, EAX, (unsigned int)r4300->mem->handlers[0].write32);
+        mov_reg32_preg32x4pimm32(EAX, EAX, (unsigned int)&r4300->mem->handlers[0].write32);
         cmp_reg32_imm32(EAX, (unsigned int)write_rdram_dram);
 
         jump_end_rel8(r4300);
@@ -820,6 +820,14 @@ static osal_inline void mov_reg64_preg64pimm8(int reg1, int reg2, unsigned int i
     put8(imm8);
 }
 
+static osal_inline void movzx_reg32_preg64preg64(int reg1, int reg2, int reg3)
+{
+    put8(0x0F);
+    put8(0xB6);
+    put8((reg1 << 3) | 0x04);
+    put8(reg2 | (reg3 << 3));
+}
+
 static osal_inline void lea_reg64_preg64x2preg64(int reg1, int reg2, int reg3)
 {
     put8(0x48);
@@ -401,8 +401,10 @@ void gen_LB(struct r4300_core* r4300)
 
         shr_reg64_imm8(gpr1, 16);
         and_reg32_imm32(gpr1, 0x1fff);
+        mov_reg64_imm64(base1, (unsigned long long) r4300->mem->handler_index);
+        movzx_reg32_preg64preg64(gpr1, base1, gpr1);
         lea_reg64_preg64x2preg64(gpr1, gpr1, gpr1);
-        mov_reg64_imm64(base1, (unsigned long long) r4300->mem->handlers[0].read32);
+        mov_reg64_imm64(base1, (unsigned long long) &r4300->mem->handlers[0].read32);
         mov_reg64_preg64x8preg64(gpr1, gpr1, base1);
         mov_reg64_imm64(base1, (unsigned long long) read_rdram_dram);
         cmp_reg64_reg64(gpr1, base1);
@@ -474,8 +476,10 @@ void gen_LBU(struct r4300_core* r4300)
 
         shr_reg64_imm8(gpr1, 16);
         and_reg32_imm32(gpr1, 0x1fff);
+        mov_reg64_imm64(base1, (unsigned long long) r4300->mem->handler_index);
+        movzx_reg32_preg64preg64(gpr1, base1, gpr1);
         lea_reg64_preg64x2preg64(gpr1, gpr1, gpr1);
-        mov_reg64_imm64(base1, (unsigned long long) r4300->mem->handlers[0].read32);
+        mov_reg64_imm64(base1, (unsigned long long) &r4300->mem->handlers[0].read32);
         mov_reg64_preg64x8preg64(gpr1, gpr1, base1);
         mov_reg64_imm64(base1, (unsigned long long) read_rdram_dram);
         cmp_reg64_reg64(gpr1, base1);
@@ -547,8 +551,10 @@ void gen_LH(struct r4300_core* r4300)
 
         shr_reg64_imm8(gpr1, 16);
         and_reg32_imm32(gpr1, 0x1fff);
+        mov_reg64_imm64(base1, (unsigned long long) r4300->mem->handler_index);
+        movzx_reg32_preg64preg64(gpr1, base1, gpr1);
         lea_reg64_preg64x2preg64(gpr1, gpr1, gpr1);
-        mov_reg64_imm64(base1, (unsigned long long) r4300->mem->handlers[0].read32);
+        mov_reg64_imm64(base1, (unsigned long long) &r4300->mem->handlers[0].read32);
         mov_reg64_preg64x8preg64(gpr1, gpr1, base1);
         mov_reg64_imm64(base1, (unsigned long long) read_rdram_dram);
         cmp_reg64_reg64(gpr1, base1);
@@ -619,8 +625,10 @@ void gen_LHU(struct r4300_core* r4300)
 
         shr_reg64_imm8(gpr1, 16);
         and_reg32_imm32(gpr1, 0x1fff);
+        mov_reg64_imm64(base1, (unsigned long long) r4300->mem->handler_index);
+        movzx_reg32_preg64preg64(gpr1, base1, gpr1);
         lea_reg64_preg64x2preg64(gpr1, gpr1, gpr1);
-        mov_reg64_imm64(base1, (unsigned long long) r4300->mem->handlers[0].read32);
+        mov_reg64_imm64(base1, (unsigned long long) &r4300->mem->handlers[0].read32);
         mov_reg64_preg64x8preg64(gpr1, gpr1, base1);
         mov_reg64_imm64(base1, (unsigned long long) read_rdram_dram);
         cmp_reg64_reg64(gpr1, base1);
@@ -699,8 +707,10 @@ void gen_LW(struct r4300_core* r4300)
 
         shr_reg64_imm8(gpr1, 16);
         and_reg32_imm32(gpr1, 0x1fff);
+        mov_reg64_imm64(base1, (unsigned long long) r4300->mem->handler_index);
+        movzx_reg32_preg64preg64(gpr1, base1, gpr1);
         lea_reg64_preg64x2preg64(gpr1, gpr1, gpr1);
-        mov_reg64_imm64(base1, (unsigned long long) r4300->mem->handlers[0].read32);
+        mov_reg64_imm64(base1, (unsigned long long) &r4300->mem->handlers[0].read32);
         mov_reg64_preg64x8preg64(gpr1, gpr1, base1);
         mov_reg64_imm64(base1, (unsigned long long) read_rdram_dram);
         cmp_reg64_reg64(gpr1, base1);
@@ -756,8 +766,10 @@ void gen_LWU(struct r4300_core* r4300)
 
         shr_reg64_imm8(gpr1, 16);
         and_reg32_imm32(gpr1, 0x1fff);
+        mov_reg64_imm64(base1, (unsigned long long) r4300->mem->handler_index);
+        movzx_reg32_preg64preg64(gpr1, base1, gpr1);
         lea_reg64_preg64x2preg64(gpr1, gpr1, gpr1);
-        mov_reg64_imm64(base1, (unsigned long long) r4300->mem->handlers[0].read32);
+        mov_reg64_imm64(base1, (unsigned long long) &r4300->mem->handlers[0].read32);
         mov_reg64_preg64x8preg64(gpr1, gpr1, base1);
         mov_reg64_imm64(base1, (unsigned long long) read_rdram_dram);
         cmp_reg64_reg64(gpr1, base1);
@@ -829,8 +841,10 @@ void gen_LD(struct r4300_core* r4300)
 
         shr_reg64_imm8(RAX, 16);
         and_reg32_imm32(EAX, 0x1fff);
+        mov_reg64_imm64(RSI, (unsigned long long) r4300->mem->handler_index);
+        movzx_reg32_preg64preg64(RAX, RSI, RAX);
         lea_reg64_preg64x2preg64(RAX, RAX, RAX);
-        mov_reg64_imm64(RSI, (unsigned long long) r4300->mem->handlers[0].read32);
+        mov_reg64_imm64(RSI, (unsigned long long) &r4300->mem->handlers[0].read32);
         mov_reg64_preg64x8preg64(RAX, RAX, RSI);
         mov_reg64_imm64(RSI, (unsigned long long) read_rdram_dram);
         cmp_reg64_reg64(RAX, RSI);
@@ -909,8 +923,10 @@ void gen_SB(struct r4300_core* r4300)
 
         shr_reg64_imm8(RAX, 16);
         and_reg32_imm32(EAX, 0x1fff);
+        mov_reg64_imm64(RSI, (unsigned long long) r4300->mem->handler_index);
+        movzx_reg32_preg64preg64(RAX, RSI, RAX);
         lea_reg64_preg64x2preg64(RAX, RAX, RAX);
-        mov_reg64_imm64(RSI, (unsigned long long) r4300->mem->handlers[0].write32);
+        mov_reg64_imm64(RSI, (unsigned long long) &r4300->mem->handlers[0].write32);
         mov_reg64_preg64x8preg64(RAX, RAX, RSI);
         mov_reg64_imm64(RSI, (unsigned long long) write_rdram_dram);
         cmp_reg64_reg64(RAX, RSI);
@@ -998,8 +1014,10 @@ void gen_SH(struct r4300_core* r4300)
 
         shr_reg64_imm8(RAX, 16);
         and_reg32_imm32(EAX, 0x1fff);
+        mov_reg64_imm64(RSI, (unsigned long long) r4300->mem->handler_index);
+        movzx_reg32_preg64preg64(RAX, RSI, RAX);
         lea_reg64_preg64x2preg64(RAX, RAX, RAX);
-        mov_reg64_imm64(RSI, (unsigned long long) r4300->mem->handlers[0].write32);
+        mov_reg64_imm64(RSI, (unsigned long long) &r4300->mem->handlers[0].write32);
         mov_reg64_preg64x8preg64(RAX, RAX, RSI);
         mov_reg64_imm64(RSI, (unsigned long long) write_rdram_dram);
         cmp_reg64_reg64(RAX, RSI);
@@ -1092,8 +1110,10 @@ void gen_SW(struct r4300_core* r4300)
 
         shr_reg64_imm8(RAX, 16);
         and_reg32_imm32(EAX, 0x1fff);
+        mov_reg64_imm64(RSI, (unsigned long long) r4300->mem->handler_index);
+        movzx_reg32_preg64preg64(RAX, RSI, RAX);
         lea_reg64_preg64x2preg64(RAX, RAX, RAX);
-        mov_reg64_imm64(RSI, (unsigned long long) r4300->mem->handlers[0].write32);
+        mov_reg64_imm64(RSI, (unsigned long long) &r4300->mem->handlers[0].write32);
         mov_reg64_preg64x8preg64(RAX, RAX, RSI);
         mov_reg64_imm64(RSI, (unsigned long long) write_rdram_dram);
         cmp_reg64_reg64(RAX, RSI);
@@ -1184,8 +1204,10 @@ void gen_SD(struct r4300_core* r4300)
 
         shr_reg64_imm8(RAX, 16);
         and_reg32_imm32(EAX, 0x1fff);
+        mov_reg64_imm64(RSI, (unsigned long long) r4300->mem->handler_index);
+        movzx_reg32_preg64preg64(RAX, RSI, RAX);
         lea_reg64_preg64x2preg64(RAX, RAX, RAX);
-        mov_reg64_imm64(RSI, (unsigned long long) r4300->mem->handlers[0].write32);
+        mov_reg64_imm64(RSI, (unsigned long long) &r4300->mem->handlers[0].write32);
         mov_reg64_preg64x8preg64(RAX, RAX, RSI);
         mov_reg64_imm64(RSI, (unsigned long long) write_rdram_dram);
         cmp_reg64_reg64(RAX, RSI);
@@ -4354,8 +4376,10 @@ void gen_LWC1(struct r4300_core* r4300)
 
         shr_reg64_imm8(RAX, 16);
         and_reg32_imm32(EAX, 0x1fff);
+        mov_reg64_imm64(RSI, (unsigned long long) r4300->mem->handler_index);
+        movzx_reg32_preg64preg64(RAX, RSI, RAX);
         lea_reg64_preg64x2preg64(RAX, RAX, RAX);
-        mov_reg64_imm64(RSI, (unsigned long long) r4300->mem->handlers[0].read32);
+        mov_reg64_imm64(RSI, (unsigned long long) &r4300->mem->handlers[0].read32);
         mov_reg64_preg64x8preg64(RAX, RAX, RSI);
         mov_reg64_imm64(RSI, (unsigned long long) read_rdram_dram);
         cmp_reg64_reg64(RAX, RSI);
@@ -4408,8 +4432,10 @@ void gen_LDC1(struct r4300_core* r4300)
 
         shr_reg64_imm8(RAX, 16);
         and_reg32_imm32(EAX, 0x1fff);
+        mov_reg64_imm64(RSI, (unsigned long long) r4300->mem->handler_index);
+        movzx_reg32_preg64preg64(RAX, RSI, RAX);
         lea_reg64_preg64x2preg64(RAX, RAX, RAX);
-        mov_reg64_imm64(RSI, (unsigned long long) r4300->mem->handlers[0].read32);
+        mov_reg64_imm64(RSI, (unsigned long long) &r4300->mem->handlers[0].read32);
         mov_reg64_preg64x8preg64(RAX, RAX, RSI);
         mov_reg64_imm64(RSI, (unsigned long long) read_rdram_dram);
         cmp_reg64_reg64(RAX, RSI);
@@ -4466,8 +4492,10 @@ void gen_SWC1(struct r4300_core* r4300)
 
         shr_reg64_imm8(RAX, 16);
         and_reg32_imm32(EAX, 0x1fff);
+        mov_reg64_imm64(RSI, (unsigned long long) r4300->mem->handler_index);
+        movzx_reg32_preg64preg64(RAX, RSI, RAX);
         lea_reg64_preg64x2preg64(RAX, RAX, RAX);
-        mov_reg64_imm64(RSI, (unsigned long long) r4300->mem->handlers[0].write32);
+        mov_reg64_imm64(RSI, (unsigned long long) &r4300->mem->handlers[0].write32);
         mov_reg64_preg64x8preg64(RAX, RAX, RSI);
         mov_reg64_imm64(RSI, (unsigned long long) write_rdram_dram);
         cmp_reg64_reg64(RAX, RSI);
@@ -4543,8 +4571,10 @@ void gen_SDC1(struct r4300_core* r4300)
 
         shr_reg64_imm8(RAX, 16);
         and_reg32_imm32(EAX, 0x1fff);
+        mov_reg64_imm64(RSI, (unsigned long long) r4300->mem->handler_index);
+        movzx_reg32_preg64preg64(RAX, RSI, RAX);
         lea_reg64_preg64x2preg64(RAX, RAX, RAX);
-        mov_reg64_imm64(RSI, (unsigned long long) r4300->mem->handlers[0].write32);
+        mov_reg64_imm64(RSI, (unsigned long long) &r4300->mem->handlers[0].write32);
         mov_reg64_preg64x8preg64(RAX, RAX, RSI);
         mov_reg64_imm64(RSI, (unsigned long long) write_rdram_dram);
         cmp_reg64_reg64(RAX, RSI);
@@ -31,11 +31,31 @@
 
 #include <string.h>
 
+#define XXH_INLINE_ALL
+#include <xxhash.h>
+
 static osal_inline size_t fb_buffer_size(const FrameBufferInfo* fb_info)
 {
     return fb_info->width * fb_info->height * fb_info->size;
 }
 
+/* Dynarecs access RDRAM directly, so the fb handlers can't be used with them.
+ * Instead, when DynarecFramebufferTracking is set, fbs are tracked at GFX task
+ * boundaries: every fb is read back (fBRead) right after each task, whether
+ * the CPU touches it or not, and the CPU writes made since then are reported
+ * (fBWrite) when the next task starts. Writes followed by a VI swap without a
+ * task in between are not reported before the swap, or at all if the
+ * plugin's fb infos no longer cover them by then. */
+static osal_inline int fb_tracks_pages(const struct fb* fb)
+{
+    return fb->track_pages && fb->r4300->emumode == EMUMODE_DYNAREC;
+}
+
+static uint64_t hash_fb_page(const struct fb* fb, size_t page)
+{
+    return XXH3_64bits(&fb->rdram->dram[page << 10], 0x1000);
+}
+
 void pre_framebuffer_read(struct fb* fb, uint32_t address)
 {
     if (!fb->infos[0].addr) {
@@ -63,20 +83,99 @@ void pre_framebuffer_read(struct fb* fb, uint32_t address)
     }
 }
 
+static void notify_fb_write(struct fb* fb, uint32_t address, uint32_t length, int update_hashes)
+{
+    size_t i, j, count = 0;
+    uint32_t begins[FB_INFOS_COUNT];
+    uint32_t ends[FB_INFOS_COUNT];
+    uint32_t last = address + length - 1;
+
+    /* collect the parts of [address, last] which are within a fb,
+     * sorted by their beginning */
+    for (i = 0; i < FB_INFOS_COUNT; ++i) {
+
+        /* skip empty fb info */
+        if (fb->infos[i].addr == 0) {
+            continue;
+        }
+
+        uint32_t begin = fb->infos[i].addr;
+        uint32_t end   = fb->infos[i].addr + fb_buffer_size(&fb->infos[i]) - 1;
+
+        if (address > begin) { begin = address; }
+        if (last < end) { end = last; }
+        if (begin > end) {
+            continue;
+        }
+
+        for (j = count; j > 0 && begins[j-1] > begin; --j) {
+            begins[j] = begins[j-1];
+            ends[j]   = ends[j-1];
+        }
+        begins[j] = begin;
+        ends[j]   = end;
+        ++count;
+    }
+
+    /* notify GFX plugin once per range, merging the ones of overlapping fbs */
+    for (i = 0; i < count; i = j) {
+        uint32_t end = ends[i];
+
+        for (j = i + 1; j < count && begins[j] <= end + 1; ++j) {
+            if (ends[j] > end) { end = ends[j]; }
+        }
+
+        gfx.fBWrite(begins[i], end - begins[i] + 1);
+
+        /* the plugin already knows about these pages,
+         * don't report them again when unprotecting */
+        if (update_hashes) {
+            size_t page;
+            size_t last_page = end >> 12;
+            size_t pages_count = fb->rdram->dram_size >> 12;
+
+            for (page = begins[i] >> 12; page <= last_page && page < pages_count; ++page) {
+                fb->page_hash[page] = hash_fb_page(fb, page);
+            }
+        }
+    }
+}
+
 void post_framebuffer_write(struct fb* fb, uint32_t address, uint32_t length)
 {
-    if (!fb->infos[0].addr) {
+    if (!fb->infos[0].addr || length == 0) {
         return;
     }
 
-    size_t i, j;
-    unsigned char size;
-    if (length % 4 == 0)
-        size = 4;
-    else if (length % 2 == 0)
-        size = 2;
-    else
-        size = 1;
+    notify_fb_write(fb, address, length, fb_tracks_pages(fb));
+}
+
+/* Each fb is read back once, as soon as the GFX plugin is done with it
+ * (plugins copy the whole fb containing the address), and its page hashes
+ * are used to find out which pages were written before the next task. */
+static void read_fb(struct fb* fb, uint32_t begin, uint32_t end)
+{
+    size_t page;
+    size_t last_page = end >> 12;
+
+    if (last_page >= (fb->rdram->dram_size >> 12)) {
+        last_page = (fb->rdram->dram_size >> 12) - 1;
+    }
+
+    gfx.fBRead(begin);
+
+    for (page = begin >> 12; page <= last_page; ++page) {
+        fb->page_hash[page] = hash_fb_page(fb, page);
+    }
+}
+
+static void write_fb_pages(struct fb* fb)
+{
+    size_t i, page, last_page;
+    uint32_t written[FB_DIRTY_PAGES_COUNT / 32];
+    size_t pages_count = fb->rdram->dram_size >> 12;
+
+    memset(written, 0, sizeof(written));
 
     for (i = 0; i < FB_INFOS_COUNT; ++i) {
 
@@ -85,27 +184,42 @@ void post_framebuffer_write(struct fb* fb, uint32_t address, uint32_t length)
             continue;
         }
 
-        /* if address in within a fb notify GFX plugin */
-        uint32_t begin = fb->infos[i].addr;
-        uint32_t end   = fb->infos[i].addr + fb_buffer_size(&fb->infos[i]) - 1;
+        page      = fb->infos[i].addr >> 12;
+        last_page = (fb->infos[i].addr + fb_buffer_size(&fb->infos[i]) - 1) >> 12;
 
-        for (j = 0; j < length; j += size) {
-            if ((address + j >= begin) && (address + j <= end)) {
-                gfx.fBWrite(address + j, size);
+        for (; page <= last_page && page < pages_count; ++page) {
+            uint64_t hash = hash_fb_page(fb, page);
+            if (hash != fb->page_hash[page]) {
+                fb->page_hash[page] = hash;
+                written[page >> 5] |= UINT32_C(1) << (page & 31);
             }
         }
     }
-}
 
+    /* notify GFX plugin once per run of written pages */
+    for (page = 0; page < pages_count; page = last_page) {
+        if (!(written[page >> 5] & (UINT32_C(1) << (page & 31)))) {
+            last_page = page + 1;
+            continue;
+        }
+
+        for (last_page = page + 1; last_page < pages_count
+             && (written[last_page >> 5] & (UINT32_C(1) << (last_page & 31))); ++last_page);
+
+        notify_fb_write(fb, (uint32_t)(page << 12), (uint32_t)((last_page - page) << 12), 0);
+    }
+}
 
 void init_fb(struct fb* fb,
              struct memory* mem,
              struct rdram* rdram,
-             struct r4300_core* r4300)
+             struct r4300_core* r4300,
+             int track_pages)
 {
     fb->mem = mem;
     fb->rdram = rdram;
     fb->r4300 = r4300;
+    fb->track_pages = track_pages;
 }
 
 void poweron_fb(struct fb* fb)
@@ -196,7 +310,7 @@ void protect_framebuffers(struct fb* fb)
 
     /* check API support */
     if (!(gfx.fBGetFrameBufferInfo && gfx.fBRead && gfx.fBWrite)
-        || fb->r4300->emumode == EMUMODE_DYNAREC /* Dynarecs currently miss some of the read/writes needed for FBInfo */) {
+        || (fb->r4300->emumode == EMUMODE_DYNAREC && !fb_tracks_pages(fb)) /* Dynarecs currently miss some of the read/writes needed for FBInfo */) {
         return;
     }
 
@@ -215,16 +329,22 @@ void protect_framebuffers(struct fb* fb)
             continue;
         }
 
-        /* map fb rw handlers */
         fb_mapping.begin = fb->infos[i].addr;
         fb_mapping.end   = fb->infos[i].addr + fb_buffer_size(&fb->infos[i]) - 1;
-        apply_mem_mapping(fb->mem, &fb_mapping);
+
+        if (fb_tracks_pages(fb)) {
+            read_fb(fb, fb_mapping.begin, fb_mapping.end);
+            continue;
+        }
 
         /* mark all pages that are within a fb as dirty */
         for (j = fb_mapping.begin >> 12; j <= (fb_mapping.end >> 12); ++j) {
             fb->dirty_page[j] = 1;
         }
 
+        /* map fb rw handlers */
+        apply_mem_mapping(fb->mem, &fb_mapping);
+
         /* disable dynarec "fast memory" code generation to avoid direct memory accesses */
         if (fb->once) {
             fb->once = 0;
@@ -248,6 +368,12 @@ void unprotect_framebuffers(struct fb* fb)
         return;
     }
 
+    /* pages were not protected, look for the written ones */
+    if (fb_tracks_pages(fb)) {
+        write_fb_pages(fb);
+        return;
+    }
+
     for (i = 0; i < FB_INFOS_COUNT; ++i) {
 
         /* skip empty fb info */
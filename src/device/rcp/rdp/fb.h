@@ -38,8 +38,12 @@ struct fb
     struct memory* mem;
     struct rdram* rdram;
     struct r4300_core* r4300;
+    int track_pages;
 
     unsigned char dirty_page[FB_DIRTY_PAGES_COUNT];
+    /* Dynarecs access RDRAM without going through the fb handlers,
+     * so their writes are found by comparing page hashes instead */
+    uint64_t page_hash[FB_DIRTY_PAGES_COUNT];
     FrameBufferInfo infos[FB_INFOS_COUNT];
     unsigned int once;
 };
@@ -47,7 +51,8 @@ struct fb
 void init_fb(struct fb* fb,
              struct memory* mem,
              struct rdram* rdram,
-             struct r4300_core* r4300);
+             struct r4300_core* r4300,
+             int track_pages);
 
 void poweron_fb(struct fb* fb);
 
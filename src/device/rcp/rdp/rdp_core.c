@@ -61,12 +61,13 @@ void init_rdp(struct rdp_core* dp,
               struct mi_controller* mi,
               struct memory* mem,
               struct rdram* rdram,
-              struct r4300_core* r4300)
+              struct r4300_core* r4300,
+              int fb_track_pages)
 {
     dp->sp = sp;
     dp->mi = mi;
 
-    init_fb(&dp->fb, mem, rdram, r4300);
+    init_fb(&dp->fb, mem, rdram, r4300, fb_track_pages);
 }
 
 void poweron_rdp(struct rdp_core* dp)
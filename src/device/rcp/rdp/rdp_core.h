@@ -108,7 +108,8 @@ void init_rdp(struct rdp_core* dp,
               struct mi_controller* mi,
               struct memory* mem,
               struct rdram* rdram,
-              struct r4300_core* r4300);
+              struct r4300_core* r4300,
+              int fb_track_pages);
 
 void poweron_rdp(struct rdp_core* dp);
 
@@ -36,9 +36,47 @@
 #include "plugin/plugin.h"
 #include "api/callbacks.h"
 
+/* Copy length bytes between two byte swizzled memories wrapping at
+ * dstmask+1 and srcmask+1 bytes. Addresses sharing the same byte lane
+ * have the same swizzle, so whole words can be copied as is. */
+static void sp_dma_copy(unsigned char* dst, unsigned int* dstaddr, unsigned int dstmask,
+                        const unsigned char* src, unsigned int* srcaddr, unsigned int srcmask,
+                        unsigned int length)
+{
+    unsigned int n;
+
+    if (((*dstaddr ^ *srcaddr) & 3) == 0)
+    {
+        for(; length > 0 && (*dstaddr & 3) != 0; --length) {
+            dst[(*dstaddr^S8) & dstmask] = src[(*srcaddr^S8) & srcmask];
+            (*dstaddr)++;
+            (*srcaddr)++;
+        }
+
+        while (length >= 4) {
+            n = length & ~3u;
+            if (n > dstmask + 1 - (*dstaddr & dstmask))
+                n = dstmask + 1 - (*dstaddr & dstmask);
+            if (n > srcmask + 1 - (*srcaddr & srcmask))
+                n = srcmask + 1 - (*srcaddr & srcmask);
+
+            memcpy(dst + (*dstaddr & dstmask), src + (*srcaddr & srcmask), n);
+            *dstaddr += n;
+            *srcaddr += n;
+            length -= n;
+        }
+    }
+
+    for(; length > 0; --length) {
+        dst[(*dstaddr^S8) & dstmask] = src[(*srcaddr^S8) & srcmask];
+        (*dstaddr)++;
+        (*srcaddr)++;
+    }
+}
+
 static void do_sp_dma(struct rsp_core* sp, const struct sp_dma* dma)
 {
-    unsigned int i,j;
+    unsigned int j;
 
     unsigned int l = dma->length;
 
@@ -54,16 +92,22 @@ static void do_sp_dma(struct rsp_core* sp, const struct sp_dma* dma)
 
     if (dma->dir == SP_DMA_READ)
     {
+        /* range of contiguous rows not yet notified to the fb */
+        unsigned int fb_begin = dramaddr;
+        unsigned int fb_end = dramaddr;
+
         for(j=0; j<count; j++) {
-            for(i=0; i<length; i++) {
-                dram[(dramaddr^S8) & 0x7fffff] = spmem[(memaddr^S8) & 0xfff];
-                memaddr++;
-                dramaddr++;
+            sp_dma_copy(dram, &dramaddr, 0x7fffff, spmem, &memaddr, 0xfff, length);
+            if (dramaddr <= 0x800000) {
+                if (dramaddr - length != fb_end) {
+                    post_framebuffer_write(&sp->dp->fb, fb_begin, fb_end - fb_begin);
+                    fb_begin = dramaddr - length;
+                }
+                fb_end = dramaddr;
             }
-            if (dramaddr <= 0x800000)
-                post_framebuffer_write(&sp->dp->fb, dramaddr - length, length);
             dramaddr+=skip;
         }
+        post_framebuffer_write(&sp->dp->fb, fb_begin, fb_end - fb_begin);
 
         sp->regs[SP_MEM_ADDR_REG] = memaddr & 0xfff;
         sp->regs[SP_DRAM_ADDR_REG] = dramaddr & 0xffffff;
@@ -71,15 +115,22 @@ static void do_sp_dma(struct rsp_core* sp, const struct sp_dma* dma)
     }
     else
     {
-        for(j=0; j<count; j++) {
-            if (dramaddr < 0x800000)
-                pre_framebuffer_read(&sp->dp->fb, dramaddr);
+        /* last page notified to the fb */
+        unsigned int fb_page = ~0u;
+        unsigned int page;
 
-            for(i=0; i<length; i++) {
-                spmem[(memaddr^S8) & 0xfff] = dram[(dramaddr^S8) & 0x7fffff];
-                memaddr++;
-                dramaddr++;
+        for(j=0; j<count; j++) {
+            if (dramaddr < 0x800000) {
+                /* every page of the row, but only once for contiguous rows */
+                for(page = dramaddr >> 12; page <= (dramaddr + length - 1) >> 12 && page < 0x800; ++page) {
+                    if (page != fb_page) {
+                        pre_framebuffer_read(&sp->dp->fb, (page << 12 > dramaddr) ? page << 12 : dramaddr);
+                        fb_page = page;
+                    }
+                }
             }
+
+            sp_dma_copy(spmem, &memaddr, 0xfff, dram, &dramaddr, 0x7fffff, length);
             dramaddr+=skip;
         }
 
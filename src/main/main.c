@@ -64,11 +64,13 @@
 #include "device/controllers/paks/transferpak.h"
 #include "device/gb/gb_cart.h"
 #include "device/pif/bootrom_hle.h"
+#include "device/r4300/perf_map.h"
 #include "eventloop.h"
 #include "main.h"
 #include "osal/files.h"
 #include "osal/preproc.h"
 #include "osd/osd.h"
+#include "pacer.h"
 #include "plugin/plugin.h"
 #if defined(PROFILE)
 #include "profile.h"
@@ -123,6 +125,7 @@ static int   l_TakeScreenshot = 0;       // Tell OSD Rendering callback to take
 static int   l_SpeedFactor = 100;        // percentage of nominal game speed at which emulator is running
 static int   l_FrameAdvance = 0;         // variable to check if we pause on next frame
 static int   l_MainSpeedLimit = 1;       // insert delay during vi_interrupt to keep speed at real-time
+static struct frame_pacer l_pacer;       // paces and times the frames for the speed limiter
 
 static osd_message_t *l_msgVol = NULL;
 static osd_message_t *l_msgFF = NULL;
@@ -184,6 +187,25 @@ static char *get_save_filename(void)
     return filename;
 }
 
+static const char *get_block_cache_path(void)
+{
+    static char path[1024];
+
+    if (!ConfigGetParamBool(g_CoreConfig, "NewDynarecBlockCache"))
+        return NULL;
+
+    snprintf(path, 1024, "%sdynarec%c", ConfigGetUserCachePath(), OSAL_DIR_SEPARATORS[0]);
+    path[1023] = 0;
+
+    /* create directory if it doesn't exist */
+    osal_mkdirp(path, 0700);
+
+    snprintf(path + strlen(path), 1024 - strlen(path), "%.32s.blk", ROM_SETTINGS.MD5);
+    path[1023] = 0;
+
+    return path;
+}
+
 static char *get_mempaks_path(void)
 {
     char *path;
@@ -424,6 +446,12 @@ int main_set_core_defaults(void)
     ConfigSetDefaultInt(g_CoreConfig, "R4300Emulator", 1, "Use Pure Interpreter if 0, Cached Interpreter if 1, or Dynamic Recompiler if 2 or more");
 #endif
     ConfigSetDefaultBool(g_CoreConfig, "NoCompiledJump", 0, "Disable compiled jump commands in dynamic recompiler (should be set to False) ");
+    ConfigSetDefaultBool(g_CoreConfig, "PureInterpreterThreaded", 0, "Dispatch the Pure Interpreter's instructions from a cache of decoded RDRAM pages instead of decoding each instruction it runs");
+    ConfigSetDefaultInt(g_CoreConfig, "NewDynarecCacheSize", 32, "Size in MB of the new dynamic recompiler's code cache (power of two, 4 or more)");
+    ConfigSetDefaultInt(g_CoreConfig, "NewDynarecCacheSizeMax", 0, "Size in MB up to which the new dynamic recompiler's code cache may grow when it is full (0: never grow)");
+    ConfigSetDefaultBool(g_CoreConfig, "NewDynarecBlockCache", 0, "Remember which blocks the new dynamic recompiler compiled and recompile them ahead of use, a few per interrupt, on the next run of the same ROM");
+    ConfigSetDefaultBool(g_CoreConfig, "DynarecFramebufferTracking", 0, "Report framebuffer accesses to the video plugin in dynamic recompiler mode, by reading each framebuffer back after every graphics task and reporting CPU writes at the next one");
+    ConfigSetDefaultInt(g_CoreConfig, "PerfMap", 0, "Describe the code generated by the dynamic recompilers to Linux perf: 0=off, 1=/tmp/perf-<pid>.map, 2=/tmp/jit-<pid>.dump (jitdump), 3=both");
     ConfigSetDefaultBool(g_CoreConfig, "DisableExtraMem", 0, "Disable 4MB expansion RAM pack. May be necessary for some games");
     ConfigSetDefaultInt(g_CoreConfig, "CountPerOp", 0, "Force number of cycles per emulated instruction");
     ConfigSetDefaultInt(g_CoreConfig, "CountPerOpDenomPot", 0, "Reduce number of cycles per update by power of two when set greater than 0 (overclock)");
@@ -961,33 +989,19 @@ void new_frame(void)
     }
 }
 
+void main_get_frame_pacer_stats(m64p_dbg_frame_pacer_stats* stats)
+{
+    frame_pacer_get_stats(&l_pacer, stats);
+}
+
 static void apply_speed_limiter(void)
 {
-    static unsigned long totalVIs = 0;
-    static int resetOnce = 0;
-    static int lastSpeedFactor = 100;
-    static unsigned int StartFPSTime = 0;
     static const double defaultSpeedFactor = 100.0;
-    unsigned int CurrentFPSTime = SDL_GetTicks();
 
     // calculate frame duration based upon ROM setting (50/60hz) and mupen64plus speed adjustment
-    const double VILimitMilliseconds = 1000.0 / g_dev.vi.expected_refresh_rate;
+    const double VILimitNanoseconds = 1000000000.0 / g_dev.vi.expected_refresh_rate;
     const double SpeedFactorMultiple = defaultSpeedFactor/l_SpeedFactor;
-    const double AdjustedLimit = VILimitMilliseconds * SpeedFactorMultiple;
-
-    //if this is the first time or we are resuming from pause
-    if(StartFPSTime == 0 || !resetOnce || lastSpeedFactor != l_SpeedFactor)
-    {
-       StartFPSTime = CurrentFPSTime;
-       totalVIs = 0;
-       resetOnce = 1;
-    }
-    else
-    {
-        ++totalVIs;
-    }
-
-    lastSpeedFactor = l_SpeedFactor;
+    const uint64_t AdjustedLimit = (uint64_t)(VILimitNanoseconds * SpeedFactorMultiple);
 
 #if defined(PROFILE)
     timed_section_start(TIMED_SECTION_IDLE);
@@ -997,33 +1011,7 @@ static void apply_speed_limiter(void)
     if(g_DebuggerActive) DebuggerCallback(DEBUG_UI_VI, 0);
 #endif
 
-    double totalElapsedGameTime = AdjustedLimit*totalVIs;
-    double elapsedRealTime = CurrentFPSTime - StartFPSTime;
-    double sleepTime = totalElapsedGameTime - elapsedRealTime;
-
-    //Reset if the sleep needed is an unreasonable value
-    static const double minSleepNeeded = -50;
-    static const double maxSleepNeeded = 50;
-    if(sleepTime < minSleepNeeded || sleepTime > (maxSleepNeeded*SpeedFactorMultiple))
-    {
-       resetOnce = 0;
-    }
-
-    if (sleepTime < minSleepNeeded) {
-        totalVIs += (unsigned long)(minSleepNeeded/AdjustedLimit);
-    }
-
-    if(l_MainSpeedLimit && sleepTime > 0 && sleepTime < maxSleepNeeded*SpeedFactorMultiple)
-    {
-        while(sleepTime >= 0) {
-            SDL_Delay((unsigned int) sleepTime);
-
-            CurrentFPSTime = SDL_GetTicks();
-            elapsedRealTime = CurrentFPSTime - StartFPSTime;
-            sleepTime = totalElapsedGameTime - elapsedRealTime;
-        }
-    }
-
+    frame_pacer_wait(&l_pacer, AdjustedLimit, l_MainSpeedLimit);
 
 #if defined(PROFILE)
     timed_section_end(TIMED_SECTION_IDLE);
@@ -1058,6 +1046,9 @@ static void pause_loop(void)
             SDL_Delay(10);
             main_check_inputs();
         }
+
+        /* don't count the pause as a late frame */
+        frame_pacer_reset(&l_pacer);
     }
 }
 
@@ -1586,7 +1577,11 @@ m64p_error main_run(void)
     uint32_t disable_extra_mem;
     int32_t si_dma_duration;
     int32_t no_compiled_jump;
+    int32_t pure_interp_threaded;
     int32_t randomize_interrupt;
+    int32_t fb_track_pages;
+    uint32_t new_dynarec_cache_size;
+    uint32_t new_dynarec_cache_size_max;
     struct file_storage eep;
     struct file_storage fla;
     struct file_storage sra;
@@ -1631,6 +1626,10 @@ m64p_error main_run(void)
     randomize_interrupt = !netplay_is_init() ? ConfigGetParamBool(g_CoreConfig, "RandomizeInterrupt") : 0;
     count_per_op = ConfigGetParamInt(g_CoreConfig, "CountPerOp");
     count_per_op_denom_pot = ConfigGetParamInt(g_CoreConfig, "CountPerOpDenomPot");
+    new_dynarec_cache_size = ConfigGetParamInt(g_CoreConfig, "NewDynarecCacheSize");
+    new_dynarec_cache_size_max = ConfigGetParamInt(g_CoreConfig, "NewDynarecCacheSizeMax");
+    pure_interp_threaded = ConfigGetParamBool(g_CoreConfig, "PureInterpreterThreaded");
+    fb_track_pages = ConfigGetParamBool(g_CoreConfig, "DynarecFramebufferTracking");
 
     if (ROM_SETTINGS.disableextramem)
         disable_extra_mem = ROM_SETTINGS.disableextramem;
@@ -1905,9 +1904,14 @@ m64p_error main_run(void)
                 no_compiled_jump,
                 randomize_interrupt,
                 g_start_address,
+                get_block_cache_path(),
+                new_dynarec_cache_size,
+                new_dynarec_cache_size_max,
+                pure_interp_threaded,
                 &g_dev.ai, &g_iaudio_out_backend_plugin_compat, ((float)ROM_SETTINGS.aidmamodifier / 100.0),
                 si_dma_duration,
                 rdram_size,
+                fb_track_pages,
                 joybus_devices, ijoybus_devices,
                 vi_clock_from_tv_standard(ROM_PARAMS.systemtype), vi_expected_refresh_rate_from_tv_standard(ROM_PARAMS.systemtype),
                 NULL, &g_iclock_ctime_plus_delta,
@@ -1969,10 +1973,17 @@ m64p_error main_run(void)
     g_EmulatorRunning = 1;
     StateChanged(M64CORE_EMU_STATE, M64EMU_RUNNING);
 
+    perf_map_open(ConfigGetParamInt(g_CoreConfig, "PerfMap"));
+
+    init_frame_pacer(&l_pacer, NULL, &g_iclock_ctime_plus_delta);
+
     poweron_device(&g_dev);
     pif_bootrom_hle_execute(&g_dev.r4300);
     run_device(&g_dev);
 
+    frame_pacer_report(&l_pacer, 1);
+    perf_map_close();
+
     /* now begin to shut down */
 #ifdef WITH_LIRC
     lircStop();
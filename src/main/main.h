@@ -87,6 +87,7 @@ void main_state_load(const char *filename);
 void main_state_save(int format, const char *filename);
 
 m64p_error main_core_state_query(m64p_core_param param, int *rval);
+void main_get_frame_pacer_stats(m64p_dbg_frame_pacer_stats* stats);
 m64p_error main_core_state_set(m64p_core_param param, int val);
 
 m64p_error main_get_screen_size(int *width, int *height);
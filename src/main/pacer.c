@@ -0,0 +1,204 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus - pacer.c                                                 *
+ *   Mupen64Plus homepage: https://mupen64plus.org/                        *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "pacer.h"
+
+#include <SDL.h>
+#include <string.h>
+
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+
+#include "api/callbacks.h"
+#include "api/m64p_types.h"
+#include "backends/api/clock_backend.h"
+
+/* further behind schedule than this, don't run fast to catch up */
+#define PACER_MAX_LAG_NS    UINT64_C(50000000)
+
+#define PACER_SPIN_MIN_NS   UINT64_C(250000)
+#define PACER_SPIN_MAX_NS   UINT64_C(4000000)
+
+#define PACER_REPORT_NS     UINT64_C(10000000000)
+
+
+static uint64_t pacer_now(const struct frame_pacer* pacer)
+{
+    return pacer->iclock->get_time_ns(pacer->clock);
+}
+
+static void reset_stats(struct frame_pacer_stats* stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->min_ns = UINT64_MAX;
+}
+
+static void add_frame_time(struct frame_pacer_stats* stats, uint64_t frame_time)
+{
+    ++stats->frames;
+    stats->total_ns += frame_time;
+    if (frame_time < stats->min_ns)
+        stats->min_ns = frame_time;
+    if (frame_time > stats->max_ns)
+        stats->max_ns = frame_time;
+}
+
+/* Sleep with SDL_Delay until spin_ns before the deadline, then spin.
+ * The spinning time follows how much SDL_Delay oversleeps. */
+static uint64_t sleep_until(struct frame_pacer* pacer, uint64_t deadline)
+{
+    uint64_t now = pacer_now(pacer);
+
+    if (deadline > now + pacer->spin_ns)
+    {
+        uint64_t requested = (deadline - now - pacer->spin_ns) / 1000000 * 1000000;
+
+        if (requested > 0)
+        {
+            uint64_t sleep_start = now;
+            uint64_t oversleep;
+            uint64_t target;
+
+            SDL_Delay((unsigned int)(requested / 1000000));
+            now = pacer_now(pacer);
+
+            oversleep = (now - sleep_start > requested) ? now - sleep_start - requested : 0;
+            target = oversleep + oversleep / 4;
+            if (target < PACER_SPIN_MIN_NS)
+                target = PACER_SPIN_MIN_NS;
+            if (target > PACER_SPIN_MAX_NS)
+                target = PACER_SPIN_MAX_NS;
+
+            /* grow at once, shrink slowly */
+            if (target > pacer->spin_ns)
+                pacer->spin_ns = target;
+            else
+                pacer->spin_ns -= (pacer->spin_ns - target) / 16;
+        }
+    }
+
+    while (now < deadline)
+        now = pacer_now(pacer);
+
+    return now;
+}
+
+
+void init_frame_pacer(struct frame_pacer* pacer,
+                      void* clock, const struct clock_backend_interface* iclock)
+{
+    pacer->clock = clock;
+    pacer->iclock = iclock;
+    pacer->frame_ns = 0;
+    pacer->spin_ns = 1000000;
+    pacer->stats_start = 0;
+    reset_stats(&pacer->stats);
+    reset_stats(&pacer->total);
+
+    frame_pacer_reset(pacer);
+}
+
+void frame_pacer_reset(struct frame_pacer* pacer)
+{
+    pacer->start = 0;
+    pacer->frames = 0;
+    pacer->last = 0;
+}
+
+void frame_pacer_wait(struct frame_pacer* pacer, uint64_t frame_ns, int limit)
+{
+    uint64_t now = pacer_now(pacer);
+    uint64_t deadline;
+
+    /* start a new schedule when the frame duration changes */
+    if (pacer->start == 0 || frame_ns != pacer->frame_ns || !limit)
+    {
+        pacer->start = now;
+        pacer->frames = 0;
+        pacer->frame_ns = frame_ns;
+    }
+    else
+    {
+        ++pacer->frames;
+    }
+
+    deadline = pacer->start + pacer->frames * pacer->frame_ns;
+
+    if (now > deadline)
+    {
+        ++pacer->stats.late;
+        ++pacer->total.late;
+
+        if (now - deadline > PACER_MAX_LAG_NS)
+        {
+            pacer->start = now;
+            pacer->frames = 0;
+            ++pacer->stats.resyncs;
+            ++pacer->total.resyncs;
+        }
+    }
+    else
+    {
+        now = sleep_until(pacer, deadline);
+    }
+
+    if (pacer->last != 0)
+    {
+        add_frame_time(&pacer->stats, now - pacer->last);
+        add_frame_time(&pacer->total, now - pacer->last);
+    }
+    pacer->last = now;
+
+    if (pacer->stats_start == 0)
+    {
+        pacer->stats_start = now;
+    }
+    else if (now - pacer->stats_start >= PACER_REPORT_NS)
+    {
+        frame_pacer_report(pacer, 0);
+        reset_stats(&pacer->stats);
+        pacer->stats_start = now;
+    }
+}
+
+void frame_pacer_report(struct frame_pacer* pacer, int total)
+{
+    const struct frame_pacer_stats* stats = (total) ? &pacer->total : &pacer->stats;
+
+    if (stats->frames == 0)
+        return;
+
+    DebugMessage((total) ? M64MSG_INFO : M64MSG_VERBOSE,
+        "Frame pacer: %" PRIu64 " frames, %.3f ms average, %.3f ms min, %.3f ms max, %" PRIu64 " late, %" PRIu64 " resyncs, %.3f ms spin",
+        stats->frames, (double)stats->total_ns / stats->frames / 1e6,
+        stats->min_ns / 1e6, stats->max_ns / 1e6,
+        stats->late, stats->resyncs, pacer->spin_ns / 1e6);
+}
+
+void frame_pacer_get_stats(const struct frame_pacer* pacer, m64p_dbg_frame_pacer_stats* stats)
+{
+    stats->frames = pacer->total.frames;
+    stats->total_ns = pacer->total.total_ns;
+    stats->min_ns = (pacer->total.frames == 0) ? 0 : pacer->total.min_ns;
+    stats->max_ns = pacer->total.max_ns;
+    stats->late = pacer->total.late;
+    stats->resyncs = pacer->total.resyncs;
+    stats->spin_ns = pacer->spin_ns;
+}
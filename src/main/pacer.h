@@ -0,0 +1,75 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus - pacer.h                                                 *
+ *   Mupen64Plus homepage: https://mupen64plus.org/                        *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef M64P_MAIN_PACER_H
+#define M64P_MAIN_PACER_H
+
+#include <stdint.h>
+
+#include "api/m64p_types.h"
+
+struct clock_backend_interface;
+
+struct frame_pacer_stats
+{
+    uint64_t frames;
+    uint64_t total_ns;
+    uint64_t min_ns;
+    uint64_t max_ns;
+    uint64_t late;          /* frames which started after their deadline */
+    uint64_t resyncs;       /* schedule restarts after falling too far behind */
+};
+
+struct frame_pacer
+{
+    void* clock;
+    const struct clock_backend_interface* iclock;
+
+    /* frames are due at start + frames * frame_ns, so that rounding
+     * and sleeping errors don't accumulate */
+    uint64_t start;
+    uint64_t frames;
+    uint64_t frame_ns;
+
+    /* time left before a deadline which is spent spinning instead of
+     * sleeping, adjusted to the observed oversleeping */
+    uint64_t spin_ns;
+
+    uint64_t last;
+    uint64_t stats_start;
+    struct frame_pacer_stats stats;     /* since stats_start */
+    struct frame_pacer_stats total;     /* since init */
+};
+
+void init_frame_pacer(struct frame_pacer* pacer,
+                      void* clock, const struct clock_backend_interface* iclock);
+
+/* Forget the schedule, e.g. after a pause */
+void frame_pacer_reset(struct frame_pacer* pacer);
+
+/* Wait until the next frame is due if limit is set, for frames of frame_ns */
+void frame_pacer_wait(struct frame_pacer* pacer, uint64_t frame_ns, int limit);
+
+/* Log the frame time statistics (totals since init if total is set) */
+void frame_pacer_report(struct frame_pacer* pacer, int total);
+
+void frame_pacer_get_stats(const struct frame_pacer* pacer, m64p_dbg_frame_pacer_stats* stats);
+
+#endif
@@ -430,6 +430,7 @@ static int savestates_load_m64p(struct device* dev, char *filepath)
 
     COPYARRAY(dev->r4300.cp0.tlb.LUT_r, curr, uint32_t, 0x100000);
     COPYARRAY(dev->r4300.cp0.tlb.LUT_w, curr, uint32_t, 0x100000);
+    tlb_rebuild_lookup(&dev->r4300.cp0.tlb);
 
     *r4300_llbit(&dev->r4300) = GETDATA(curr, uint32_t);
     COPYARRAY(r4300_regs(&dev->r4300), curr, int64_t, 32);
@@ -1220,6 +1221,7 @@ static int savestates_load_pj64(struct device* dev,
 
         tlb_map(&dev->r4300.cp0.tlb, i);
     }
+    tlb_rebuild_lookup(&dev->r4300.cp0.tlb);
 
     // pif ram
     COPYARRAY(dev->pif.ram, curr, uint8_t, PIF_RAM_SIZE);